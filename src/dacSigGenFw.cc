@@ -8,6 +8,8 @@
 // the terms contained in the LICENSE.txt file.
 //////////////////////////////////////////////////////////////////////////////
 #include "dacSigGenFw.h"
+#include "pcavMetrics.h"
+#include "pcavBus.h"
 
 #include <cpsw_yaml.h>
 #include <yaml-cpp/yaml.h>
@@ -18,18 +20,9 @@
 #include <sstream>
 
 #include <math.h>
+#include <string.h>
 
 
-#define CPSW_TRY_CATCH(X)       try {   \
-        (X);                            \
-    } catch (CPSWError &e) {            \
-        fprintf(stderr,                 \
-                "CPSW Error: %s at %s, line %d\n",     \
-                e.getInfo().c_str(),    \
-                __FILE__, __LINE__);    \
-        throw e;                        \
-    }
-
 class CdacSigGenFwAdapt;
 typedef shared_ptr<CdacSigGenFwAdapt> dacSigGenFwAdapt;
 
@@ -43,15 +36,51 @@ private:
     ScalVal   i_waveform_;
     ScalVal   q_waveform_;
 
+    unsigned  periodSize;      // shadows of the registers, written by this adapter only
+    uint8_t   enableMask;
+    uint8_t   modeMask;
+
+    ScalVal   &memoryArray(int channel) { return channel == DAC_CHANNEL_Q ? q_waveform_ : i_waveform_; }
+    int       check(int channel, unsigned n);
+
+    // readback verification
+    dacVerifyConfig verify;
+    dacVerifyStats  verifyStats;
+    uint32_t  rng;             // xorshift state for the random windows
+    ScalVal_RO checksum_[DAC_NUM_CHANNEL];
+    unsigned  shadowLen[DAC_NUM_CHANNEL];
+    uint32_t  shadowCrc[DAC_NUM_CHANNEL];
+
+    int       compare(int channel, unsigned first, unsigned n);
+    unsigned  sampleWords(unsigned n);
+
 protected:
-    int16_t  i_wf_out[MAX_SAMPLES];
-    int16_t  q_wf_out[MAX_SAMPLES];
+    int16_t  wf_out[MAX_SAMPLES];
+    int16_t  shadow[DAC_NUM_CHANNEL][MAX_SAMPLES];
+    int16_t  readback[MAX_SAMPLES];
 
 public:
     CdacSigGenFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie);
 
     virtual void  setIWaveform(double *i_waveform);
     virtual void  setQWaveform(double *q_waveform);
+    virtual void  setIWaveformRaw(const int16_t *i_waveform);
+    virtual void  setQWaveformRaw(const int16_t *q_waveform);
+
+    virtual int   setWaveform(int channel, const int16_t *waveform, unsigned n);
+    virtual int   setWaveform(int channel, const float *waveform, unsigned n);
+    virtual int   setWaveform(int channel, const double *waveform, unsigned n);
+    virtual int   setPeriodSize(unsigned n);
+    virtual unsigned getPeriodSize(void);
+    virtual int   setContinuous(int channel, bool continuous);
+    virtual int   setEnable(int channel, bool enable);
+
+    virtual void  setVerify(const dacVerifyConfig &config);
+    virtual int   verifyWaveform(int channel);
+    virtual uint32_t getChecksum(int channel);
+    virtual void  setChecksumRegister(int channel, const char *name);
+    virtual void  getVerifyStats(dacVerifyStats *stats);
+    virtual void  clearVerifyStats(void);
 
 };
 
@@ -73,28 +102,263 @@ CdacSigGenFwAdapt::CdacSigGenFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntr
 
 {
     uint8_t v;
-    v = 0x03; CPSW_TRY_CATCH(enableMask_->setVal(v));    // enable two waveforms I and Q
-    v = 0x00; CPSW_TRY_CATCH(modeMask_->setVal(v));      // triggered mode
-    v = 0x00; CPSW_TRY_CATCH(signFormat_->setVal(v));    // signed 2's complementary data type
-    CPSW_TRY_CATCH(periodSize_->setVal(MAX_SAMPLES));    // length of IQ table
-    
+    enableMask = 0x03; CPSW_TRY_CATCH(enableMask_, setVal(enableMask));    // enable two waveforms I and Q
+    modeMask   = 0x00; CPSW_TRY_CATCH(modeMask_, setVal(modeMask));        // triggered mode
+    v = 0x00; CPSW_TRY_CATCH(signFormat_, setVal(v));    // signed 2's complementary data type
+    periodSize = MAX_SAMPLES; CPSW_TRY_CATCH(periodSize_, setVal(periodSize));    // length of IQ table
+
+    verify.mode          = DAC_VERIFY_OFF;
+    verify.confidence    = 0.999;
+    verify.errorFraction = 0.01;
+    verify.window        = 32;
+    rng = 0x9e3779b9;
+    memset(&verifyStats, 0, sizeof(verifyStats));
+    memset(shadowLen, 0, sizeof(shadowLen));
+    memset(shadowCrc, 0, sizeof(shadowCrc));
 }
 
+// CRC-32 (IEEE 802.3, reflected), the table words as they go to the bus, little endian
+static uint32_t crc32(const int16_t *data, unsigned n)
+{
+    static uint32_t table[256];
+    static bool     init = false;
+
+    if(!init) {
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++) c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        init = true;
+    }
 
-void CdacSigGenFwAdapt::setIWaveform(double *i_waveform)
+    uint32_t crc = 0xffffffff;
+    for(unsigned i = 0; i < n; i++) {
+        uint16_t w = (uint16_t) data[i];
+        crc = table[(crc ^ w) & 0xff] ^ (crc >> 8);
+        crc = table[(crc ^ (w >> 8)) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xffffffff;
+}
+
+
+int CdacSigGenFwAdapt::check(int channel, unsigned n)
+{
+    if(channel != DAC_CHANNEL_I && channel != DAC_CHANNEL_Q) {
+        fprintf(stderr, "dacSigGenFw: invalid channel %d\n", channel);
+        return -1;
+    }
+    if(n == 0 || n > MAX_SAMPLES) {
+        fprintf(stderr, "dacSigGenFw: waveform length %u out of range 1..%d\n", n, MAX_SAMPLES);
+        return -1;
+    }
+
+    return 0;
+}
+
+int CdacSigGenFwAdapt::setPeriodSize(unsigned n)
+{
+    if(check(DAC_CHANNEL_I, n)) return -1;
+    if(n == periodSize) return 0;
+
+    CPSW_TRY_CATCH(periodSize_, setVal(n));
+    periodSize = n;
+
+    return 0;
+}
+
+unsigned CdacSigGenFwAdapt::getPeriodSize(void)
+{
+    return periodSize;
+}
+
+int CdacSigGenFwAdapt::setWaveform(int channel, const int16_t *waveform, unsigned n)
+{
+    if(check(channel, n)) return -1;
+
+    CPSW_TRY_CATCH_N(memoryArray(channel), setVal((uint16_t *) waveform, n), n);
+    if(setPeriodSize(n)) return -1;
+
+    if(verify.mode == DAC_VERIFY_OFF) {
+        shadowLen[channel] = 0;
+        return 0;
+    }
+    memcpy(shadow[channel], waveform, n * sizeof(int16_t));
+    shadowLen[channel] = n;
+    shadowCrc[channel] = crc32(waveform, n);
+
+    return verifyWaveform(channel);
+}
+
+int CdacSigGenFwAdapt::setWaveform(int channel, const float *waveform, unsigned n)
 {
-    for(int i = 0; i < MAX_SAMPLES; i++) {
-        i_wf_out[i] =(int16_t)(*(i_waveform +i) * 0x7fff);
+    if(check(channel, n)) return -1;
+
+    for(unsigned i = 0; i < n; i++) {
+        wf_out[i] = dacSample(waveform[i]);
+    }
+
+    return setWaveform(channel, wf_out, n);
+}
+
+int CdacSigGenFwAdapt::setWaveform(int channel, const double *waveform, unsigned n)
+{
+    if(check(channel, n)) return -1;
+
+    for(unsigned i = 0; i < n; i++) {
+        wf_out[i] = dacSample(waveform[i]);
     }
 
-    CPSW_TRY_CATCH(i_waveform_->setVal((uint16_t *)i_wf_out,MAX_SAMPLES));
+    return setWaveform(channel, wf_out, n);
+}
+
+int CdacSigGenFwAdapt::setContinuous(int channel, bool continuous)
+{
+    if(check(channel, 1)) return -1;
+
+    uint8_t v = continuous ? (modeMask | (0x1 << channel)) : (modeMask & ~(0x1 << channel));
+    CPSW_TRY_CATCH(modeMask_, setVal(v));
+    modeMask = v;
+
+    return 0;
+}
+
+int CdacSigGenFwAdapt::setEnable(int channel, bool enable)
+{
+    if(check(channel, 1)) return -1;
+
+    uint8_t v = enable ? (enableMask | (0x1 << channel)) : (enableMask & ~(0x1 << channel));
+    CPSW_TRY_CATCH(enableMask_, setVal(v));
+    enableMask = v;
+
+    return 0;
+}
+
+void CdacSigGenFwAdapt::setIWaveform(double *i_waveform)
+{
+    setWaveform(DAC_CHANNEL_I, (const double *) i_waveform, MAX_SAMPLES);
 }
 
 void CdacSigGenFwAdapt::setQWaveform(double *q_waveform)
 {
-    for(int i = 0; i < MAX_SAMPLES; i++) {
-        q_wf_out[i] =(int16_t)(*(q_waveform +i) * 0x7fff);
+    setWaveform(DAC_CHANNEL_Q, (const double *) q_waveform, MAX_SAMPLES);
+}
+
+void CdacSigGenFwAdapt::setIWaveformRaw(const int16_t *i_waveform)
+{
+    setWaveform(DAC_CHANNEL_I, i_waveform, MAX_SAMPLES);
+}
+
+void CdacSigGenFwAdapt::setQWaveformRaw(const int16_t *q_waveform)
+{
+    setWaveform(DAC_CHANNEL_Q, q_waveform, MAX_SAMPLES);
+}
+
+void CdacSigGenFwAdapt::setVerify(const dacVerifyConfig &config)
+{
+    verify = config;
+    if(verify.window == 0) verify.window = 1;
+}
+
+uint32_t CdacSigGenFwAdapt::getChecksum(int channel)
+{
+    if(check(channel, 1)) return 0;
+
+    return shadowCrc[channel];
+}
+
+void CdacSigGenFwAdapt::setChecksumRegister(int channel, const char *name)
+{
+    if(check(channel, 1)) return;
+    if(!name || !*name) {
+        checksum_[channel].reset();
+        return;
+    }
+
+    CPSW_TRY_CATCH_AT(name, 0, checksum_[channel] = IScalVal_RO::create(_pDacSigGen->findByName(name)));
+}
+
+void CdacSigGenFwAdapt::getVerifyStats(dacVerifyStats *stats)
+{
+    *stats = verifyStats;
+}
+
+void CdacSigGenFwAdapt::clearVerifyStats(void)
+{
+    memset(&verifyStats, 0, sizeof(verifyStats));
+}
+
+// read back n words from first and compare with the shadow
+int CdacSigGenFwAdapt::compare(int channel, unsigned first, unsigned n)
+{
+    IndexRange range(first, first + n - 1);
+
+    CPSW_TRY_CATCH_N(memoryArray(channel), getVal((uint16_t *) readback, n, &range), n);
+
+    return memcmp(readback, shadow[channel] + first, n * sizeof(int16_t)) ? -1 : 0;
+}
+
+// words to sample so that a table with errorFraction corrupted words is caught with the configured confidence
+unsigned CdacSigGenFwAdapt::sampleWords(unsigned n)
+{
+    if(verify.confidence <= 0. || verify.confidence >= 1. ||
+       verify.errorFraction <= 0. || verify.errorFraction >= 1.) return n;
+
+    double words = ceil(log(1. - verify.confidence) / log(1. - verify.errorFraction));
+
+    return words < n ? (unsigned) words : n;
+}
+
+int CdacSigGenFwAdapt::verifyWaveform(int channel)
+{
+    if(check(channel, 1)) return -1;
+
+    unsigned n = shadowLen[channel];
+    if(!n) {
+        fprintf(stderr, "dacSigGenFw: no shadow table for channel %d, verification is off\n", channel);
+        return -1;
+    }
+    verifyStats.verifications++;
+
+    if(verify.mode == DAC_VERIFY_SAMPLED) {
+        if(checksum_[channel]) {
+            uint32_t crc;
+            CPSW_TRY_CATCH(checksum_[channel], getVal(&crc));
+            if(crc == shadowCrc[channel]) {
+                verifyStats.checksumHits++;
+                return 0;
+            }
+        }
+        else {
+            unsigned w       = verify.window < n ? verify.window : n;
+            unsigned windows = (sampleWords(n) + w - 1) / w;
+            if((uint64_t) windows * w < n) {
+                unsigned strided = (windows + 1) / 2;
+                bool     bad     = false;
+
+                // strided windows cover the table evenly, the random ones catch what aliases with the stride
+                for(unsigned k = 0; k < windows && !bad; k++) {
+                    unsigned first;
+                    if(k < strided) first = (unsigned) (((uint64_t) k * (n - w)) / (strided > 1 ? strided - 1 : 1));
+                    else {
+                        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+                        first = rng % (n - w + 1);
+                    }
+                    if(compare(channel, first, w)) bad = true;
+                    verifyStats.sampledWords += w;
+                }
+                if(!bad) return 0;
+            }
+        }
+    }
+
+    verifyStats.fullReadbacks++;
+    if(compare(channel, 0, n)) {
+        verifyStats.failures++;
+        fprintf(stderr, "dacSigGenFw: channel %d table readback mismatch\n", channel);
+        return -1;
     }
 
-    CPSW_TRY_CATCH(i_waveform_->setVal((uint16_t *)q_wf_out,MAX_SAMPLES));
+    return 0;
 }
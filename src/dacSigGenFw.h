@@ -14,9 +14,49 @@
 #include <cpsw_api_user.h>
 #include <cpsw_api_builder.h>
 
+#include <stdint.h>
+#include <math.h>
+
 
 #define MAX_SAMPLES  4096
 
+#define DAC_CHANNEL_I  0
+#define DAC_CHANNEL_Q  1
+#define DAC_NUM_CHANNEL  2
+
+// full scale 1.0 to the signed 16 bit DAC format, clamped to +-32767 and rounded half away from zero, NaN is 0
+// the one conversion for setWaveform() and CpcavSynth tables
+inline int16_t dacSample(double v)
+{
+    double x = v * 0x7fff;
+
+    if(isnan(x)) return 0;
+    x = x > 32767. ? 32767. : (x < -32767. ? -32767. : x);
+
+    return (int16_t) (x + (x >= 0. ? .5 : -.5));
+}
+
+typedef enum {
+    DAC_VERIFY_OFF,            // no readback
+    DAC_VERIFY_SAMPLED,        // firmware checksum if configured, otherwise sampled readback, full readback on mismatch
+    DAC_VERIFY_FULL            // read back the whole table
+} dacVerifyMode;
+
+struct dacVerifyConfig {
+    dacVerifyMode mode;
+    double    confidence;      // probability to catch a table with errorFraction corrupted words, e.g. 0.999
+    double    errorFraction;   // smallest corrupted fraction which must be caught, e.g. 0.01
+    unsigned  window;          // words per sampled read transaction, half of the windows strided, half random
+};
+
+struct dacVerifyStats {
+    uint64_t  verifications;
+    uint64_t  checksumHits;    // verified by the firmware checksum alone
+    uint64_t  sampledWords;    // words read back by sampled verification
+    uint64_t  fullReadbacks;
+    uint64_t  failures;        // mismatch confirmed by the full readback
+};
+
 class IdacSigGenFw;
 typedef shared_ptr<IdacSigGenFw> dacSigGenFw;
 
@@ -26,6 +66,34 @@ public:
 
     virtual void setIWaveform(double *i_waveform) = 0;
     virtual void setQWaveform(double *q_waveform) = 0;
+
+    /* upload a prequantized table of MAX_SAMPLES, no conversion */
+    virtual void setIWaveformRaw(const int16_t *i_waveform) = 0;
+    virtual void setQWaveformRaw(const int16_t *q_waveform) = 0;
+
+    /* upload n samples, 1..MAX_SAMPLES, to DAC_CHANNEL_I or DAC_CHANNEL_Q
+       PeriodSize is shared by the channels and follows the last upload, it is written only when it changes
+       int16_t is passed to the bus as is, float and double are full scale 1.0,
+       rounded to nearest and clamped to +-0x7fff
+       returns 0, or -1 for an invalid channel or length */
+    virtual int  setWaveform(int channel, const int16_t *waveform, unsigned n) = 0;
+    virtual int  setWaveform(int channel, const float *waveform, unsigned n) = 0;
+    virtual int  setWaveform(int channel, const double *waveform, unsigned n) = 0;
+    virtual int  setPeriodSize(unsigned n) = 0;
+    virtual unsigned getPeriodSize(void) = 0;
+
+    /* per channel ModeMask and EnableMask bits, the other channel is kept */
+    virtual int  setContinuous(int channel, bool continuous) = 0;    // false: triggered
+    virtual int  setEnable(int channel, bool enable) = 0;
+
+    /* readback verification, with a mode other than DAC_VERIFY_OFF setWaveform() keeps a shadow
+       of the table and verifies after the upload, it returns -1 on a confirmed mismatch */
+    virtual void setVerify(const dacVerifyConfig &config) = 0;
+    virtual int  verifyWaveform(int channel) = 0;      // 0 if the table matches the shadow, -1 on mismatch
+    virtual uint32_t getChecksum(int channel) = 0;     // CRC-32 of the shadow table
+    virtual void setChecksumRegister(int channel, const char *name) = 0;    // register under DacSigGen, 0 to remove
+    virtual void getVerifyStats(dacVerifyStats *stats) = 0;
+    virtual void clearVerifyStats(void) = 0;
 };
 
 
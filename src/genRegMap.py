@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+#############################################################################
+# This file is part of 'pcavLib'.
+# It is subject to the license terms in the LICENSE.txt file found in the
+# top-level directory of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of 'pcavLib', including this file,
+# may be copied, modified, propagated, or distributed except according to
+# the terms contained in the LICENSE.txt file.
+#############################################################################
+#
+# Generates pcavRegMap.h, the register descriptor table of the PCAV firmware.
+#
+#   genRegMap.py [firmware.yaml ...] > pcavRegMap.h
+#
+# Register width, signedness and offset are taken from the firmware YAML when
+# given. The YAML has no binary point, FORMATS below give the integer bits
+# (sign included) of each field, which fix the value range; the fraction bits
+# are whatever the width leaves, so a wider register in the YAML gains
+# resolution, not range. Without a YAML the built-in widths are used, that is
+# how the checked-in pcavRegMap.h is produced.
+#
+
+import sys
+
+# suffix, enum, built-in bits, signed, integer bits, scale
+# DCReal/DCImage are fixed 21.19, the other monitors 18 bits
+PROBE_FORMATS = [
+    ('IfAmpl',    'PCAV_IF_AMPL',    18, True,  1,   1.),
+    ('IfPhase',   'PCAV_IF_PHASE',   18, True,  1, 180.),
+    ('IfI',       'PCAV_IF_I',       18, True,  1,   1.),
+    ('IfQ',       'PCAV_IF_Q',       18, True,  1,   1.),
+    ('DCReal',    'PCAV_DC_REAL',    21, True,  2,   1.),
+    ('DCImage',   'PCAV_DC_IMAGE',   21, True,  2,   1.),
+    ('DCFreq',    'PCAV_DC_FREQ',    32, True, 14,   1.),
+    ('IntegI',    'PCAV_INTEG_I',    18, True,  2,   1.),
+    ('IntegQ',    'PCAV_INTEG_Q',    18, True,  2,   1.),
+    ('OutPhase',  'PCAV_OUT_PHASE',  18, True,  3, 180.),
+    ('OutAmpl',   'PCAV_OUT_AMPL',   18, True,  2,   1.),
+    ('CompPhase', 'PCAV_COMP_PHASE', 18, True,  3, 180.),
+]
+
+REF_FORMATS = [
+    ('rfRefAmpl',  'PCAV_REF_AMPL',  18, True, 1,   1.),
+    ('rfRefPhase', 'PCAV_REF_PHASE', 18, True, 1, 180.),
+    ('rfRefI',     'PCAV_REF_I',     18, True, 1,   1.),
+    ('rfRefQ',     'PCAV_REF_Q',     18, True, 1,   1.),
+]
+
+# settings on AppDiagnBus, name pattern takes cavity and probe counted from 0
+# Weight is unsigned, the setter writes 0, 0.5, 1 or 1.5
+SETTING_FORMATS = [
+    ('Cavity%dProbe%dPhaseOffset', 'PhaseOffset', 18, True,  3, 180.),
+    ('Cavity%dProbe%dWeight',      'Weight',       2, False, 1,   1.),
+]
+
+NUM_CAVITY = 2
+NUM_PROBE  = 2
+
+
+def load_yaml(files):
+    regs = {}
+    if not files:
+        return regs
+    import yaml
+
+    def walk(node):
+        if isinstance(node, dict):
+            for k, v in node.items():
+                if isinstance(v, dict) and 'sizeBits' in v:
+                    at = v.get('at', {}) or {}
+                    regs[str(k)] = (int(v['sizeBits']),
+                                    bool(v.get('isSigned', False)),
+                                    at.get('offset'))
+                walk(v)
+        elif isinstance(node, list):
+            for v in node:
+                walk(v)
+
+    for f in files:
+        # CPSW preprocessor directives are comments to a plain YAML parser
+        with open(f) as fh:
+            for doc in yaml.safe_load_all(fh):
+                walk(doc)
+    return regs
+
+
+def lookup(regs, name, bits, signed, ibits):
+    """width, signedness, fraction bits and offset of a register"""
+    if name in regs:
+        ybits, ysigned, offset = regs[name]
+        if ybits != bits:
+            sys.stderr.write('genRegMap: %s is %d bits in the YAML, built-in %d, format becomes %d.%d\n'
+                             % (name, ybits, bits, ybits, ybits - ibits))
+        # the firmware exports the fields as raw words, the sign is in the fixed point format
+        bits = ybits
+    else:
+        offset = None
+    if bits < ibits or bits > 32:
+        sys.exit('genRegMap: %s, %d bits cannot hold %d integer bits' % (name, bits, ibits))
+    return bits, signed, bits - ibits, offset
+
+
+def fmt_offset(offset):
+    return '0x%08x' % int(offset) if offset is not None else 'PCAV_REG_NO_OFFSET'
+
+
+def main(argv):
+    regs = load_yaml(argv[1:])
+    out = []
+    w = out.append
+
+    w('// generated by genRegMap.py, do not edit')
+    w('//')
+    w('#ifndef _PCAVREGMAP_H')
+    w('#define _PCAVREGMAP_H')
+    w('')
+    w('#include <stdint.h>')
+    w('')
+    w('#include "pcavFw.h"')
+    w('')
+    w('#define PCAV_REG_NO_OFFSET  0xffffffff')
+    w('')
+    w('struct pcavRegDesc {')
+    w('    const char *name;')
+    w('    uint32_t    offset;         // byte offset in the register block, PCAV_REG_NO_OFFSET if unknown')
+    w('    uint8_t     bits;')
+    w('    bool        isSigned;')
+    w('    uint8_t     frac;           // fraction bits')
+    w('    double      scale;          // engineering unit per full scale, 180 for phases in degree')
+    w('};')
+    w('')
+    w('// raw register word to fixed point value, masked to the field width')
+    w('template <unsigned BITS, unsigned FRAC, bool SIGNED>')
+    w('inline double pcavFix(int32_t raw)')
+    w('{')
+    w('    const uint64_t mask = (BITS >= 32) ? 0xffffffffULL : ((1ULL << BITS) - 1);')
+    w('    uint64_t v = (uint64_t) (uint32_t) raw & mask;')
+    w('')
+    w('    if(SIGNED && (v & (1ULL << (BITS - 1)))) return ((double) v - (double) (1ULL << BITS)) / (double) (1ULL << FRAC);')
+    w('')
+    w('    return (double) v / (double) (1ULL << FRAC);')
+    w('}')
+    w('')
+
+    w('template <int FIELD> struct pcavProbeFmt;')
+    w('template <int FIELD> struct pcavRefFmt;')
+    w('')
+
+    # the conversion is compiled once per field, all four channels must agree on the format
+    def channel_fmt(names, bits, signed, ibits):
+        fmts = [lookup(regs, n, bits, signed, ibits) for n in names]
+        for n, f in zip(names[1:], fmts[1:]):
+            if f[:3] != fmts[0][:3]:
+                sys.exit('genRegMap: %s and %s differ in format' % (names[0], n))
+        return fmts
+
+    probe_desc = []
+    for suffix, enum, bits, signed, ibits, scale in PROBE_FORMATS:
+        names = ['cav%dP%d%s' % (c + 1, p + 1, suffix) for c in range(NUM_CAVITY) for p in range(NUM_PROBE)]
+        fmts  = channel_fmt(names, bits, signed, ibits)
+        b, s, frac, _ = fmts[0]
+        w('template <> struct pcavProbeFmt<%s> {' % enum)
+        w('    enum { bits = %d, frac = %d, isSigned = %d };' % (b, frac, int(s)))
+        w('    static double scale(void) { return %r; }' % scale)
+        w('};')
+        for i, (name, (b, s, frac, off)) in enumerate(zip(names, fmts)):
+            probe_desc.append((i // NUM_PROBE, i % NUM_PROBE, name, off, b, s, frac, scale))
+    w('')
+
+    ref_desc = []
+    for name, enum, bits, signed, ibits, scale in REF_FORMATS:
+        b, s, frac, off = lookup(regs, name, bits, signed, ibits)
+        w('template <> struct pcavRefFmt<%s> {' % enum)
+        w('    enum { bits = %d, frac = %d, isSigned = %d };' % (b, frac, int(s)))
+        w('    static double scale(void) { return %r; }' % scale)
+        w('};')
+        ref_desc.append((name, off, b, s, frac, scale))
+    w('')
+
+    setting_desc = []
+    for pattern, tag, bits, signed, ibits, scale in SETTING_FORMATS:
+        names = [pattern % (c, p) for c in range(NUM_CAVITY) for p in range(NUM_PROBE)]
+        fmts  = channel_fmt(names, bits, signed, ibits)
+        b, s, frac, _ = fmts[0]
+        w('struct pcav%sFmt {' % tag)
+        w('    enum { bits = %d, frac = %d, isSigned = %d };' % (b, frac, int(s)))
+        w('    static double scale(void) { return %r; }' % scale)
+        w('};')
+        for i, (name, (b, s, frac, off)) in enumerate(zip(names, fmts)):
+            setting_desc.append((i // NUM_PROBE, i % NUM_PROBE, name, off, b, s, frac, scale))
+    w('')
+
+    w('template <int FIELD>')
+    w('inline double pcavProbeConv(int32_t raw)')
+    w('{')
+    w('    typedef pcavProbeFmt<FIELD> F;')
+    w('')
+    w('    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);')
+    w('}')
+    w('')
+    w('template <int FIELD>')
+    w('inline double pcavRefConv(int32_t raw)')
+    w('{')
+    w('    typedef pcavRefFmt<FIELD> F;')
+    w('')
+    w('    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);')
+    w('}')
+    w('')
+    w('template <typename F>')
+    w('inline double pcavSettingConv(int32_t raw)')
+    w('{')
+    w('    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);')
+    w('}')
+    w('')
+
+    def entry(indent, name, off, b, s, frac, scale):
+        w('%s{ %-28s %s, %2d, %-5s, %2d, %5r },' % (indent, '"%s",' % name, fmt_offset(off), b,
+                                                   'true' if s else 'false', frac, scale))
+
+    def table(comment, var, desc, n):
+        w('// %s' % comment)
+        w('static const pcavRegDesc %s[%d][%d][%d] = {' % (var, NUM_CAVITY, NUM_PROBE, n))
+        for c in range(NUM_CAVITY):
+            w('    {')
+            for p in range(NUM_PROBE):
+                w('        {')
+                for cc, pp, name, off, b, s, frac, scale in desc:
+                    if cc == c and pp == p:
+                        entry('            ', name, off, b, s, frac, scale)
+                w('        },')
+            w('    },')
+        w('};')
+        w('')
+
+    table('[cavity][probe][field], under PcavReg', 'pcavProbeRegDesc', probe_desc, len(PROBE_FORMATS))
+
+    w('// [field], under PcavReg')
+    w('static const pcavRegDesc pcavRefRegDesc[%d] = {' % len(REF_FORMATS))
+    for name, off, b, s, frac, scale in ref_desc:
+        entry('    ', name, off, b, s, frac, scale)
+    w('};')
+    w('')
+
+    w('#define PCAV_SETTING_PHASE_OFFSET  0')
+    w('#define PCAV_SETTING_WEIGHT        1')
+    w('#define PCAV_NUM_SETTINGS          %d' % len(SETTING_FORMATS))
+    w('')
+    table('[cavity][probe][setting], under AppDiagnBus', 'pcavSettingRegDesc', setting_desc, len(SETTING_FORMATS))
+    w('#endif /* _PCAVREGMAP_H */')
+
+    sys.stdout.write('\n'.join(out) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavAlarm.h"
+#include "pcavMetrics.h"
+
+#include <math.h>
+
+
+CpcavAlarm::CpcavAlarm(int nBoards, size_t maxEvents):
+    nBoards_(nBoards),
+    hihi_(nBoards * PCAV_ALARM_NUM_CHANNELS,  HUGE_VAL),
+    hi_(  nBoards * PCAV_ALARM_NUM_CHANNELS,  HUGE_VAL),
+    lo_(  nBoards * PCAV_ALARM_NUM_CHANNELS, -HUGE_VAL),
+    lolo_(nBoards * PCAV_ALARM_NUM_CHANNELS, -HUGE_VAL),
+    hyst_(nBoards * PCAV_ALARM_NUM_CHANNELS, 0.),
+    value_(nBoards * PCAV_ALARM_NUM_CHANNELS, 0.),
+    level_(nBoards * PCAV_ALARM_NUM_CHANNELS, PCAV_ALARM_NONE),
+    next_(PCAV_ALARM_NUM_CHANNELS, PCAV_ALARM_NONE),
+    events_(maxEvents ? maxEvents : 1),
+    nEvents_(0),
+    dropped_(0)
+{
+}
+
+int CpcavAlarm::channel(pcavAlarmSignal signal, int cavity, int probe)
+{
+    if(signal == PCAV_ALARM_REF_AMPL) return PCAV_ALARM_REF_AMPL;
+
+    return signal + cavity * PCAV_NUM_PROBE + probe;
+}
+
+void CpcavAlarm::setLimits(int board, int channel, const pcavAlarmLimits &limits)
+{
+    if(board < 0 || board >= nBoards_ || channel < 0 || channel >= PCAV_ALARM_NUM_CHANNELS) return;
+
+    int i = board * PCAV_ALARM_NUM_CHANNELS + channel;
+    hihi_[i] = limits.hihi;
+    hi_[i]   = limits.hi;
+    lo_[i]   = limits.lo;
+    lolo_[i] = limits.lolo;
+    hyst_[i] = limits.hyst;
+}
+
+void CpcavAlarm::setLimits(int board, pcavAlarmSignal signal, const pcavAlarmLimits &limits)
+{
+    if(signal == PCAV_ALARM_REF_AMPL) {
+        setLimits(board, (int) PCAV_ALARM_REF_AMPL, limits);
+        return;
+    }
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++)
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) setLimits(board, channel(signal, c, p), limits);
+}
+
+size_t CpcavAlarm::evaluate(int board, const pcavSnapshot &snap)
+{
+    if(board < 0 || board >= nBoards_) return 0;
+
+    const int   n   = PCAV_ALARM_NUM_CHANNELS;
+    const int   off = board * n;
+    double     *v   = &value_[off];
+
+    v[PCAV_ALARM_REF_AMPL] = snap.ref[PCAV_REF_AMPL];
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            int k = c * PCAV_NUM_PROBE + p;
+            v[PCAV_ALARM_IF_AMPL   + k] = snap.val[c][p][PCAV_IF_AMPL];
+            v[PCAV_ALARM_OUT_PHASE + k] = snap.val[c][p][PCAV_OUT_PHASE];
+            v[PCAV_ALARM_DC_FREQ   + k] = snap.val[c][p][PCAV_DC_FREQ];
+        }
+    }
+
+    // one pass over the whole row, a level which is already active uses its limit
+    // relaxed by the hysteresis; 13 channels, not worth vectorizing
+    const double  *hihi = &hihi_[off], *hi = &hi_[off], *lo = &lo_[off], *lolo = &lolo_[off], *hyst = &hyst_[off];
+    const int32_t *cur  = &level_[off];
+    int32_t       *nxt  = &next_[0];
+    for(int i = 0; i < n; i++) {
+        double  x  = v[i];
+        int32_t c  = cur[i];
+        int32_t hh = x >= hihi[i] - ((c >= PCAV_ALARM_HIHI) ? hyst[i] : 0.);
+        int32_t h  = x >= hi[i]   - ((c >= PCAV_ALARM_HI)   ? hyst[i] : 0.);
+        int32_t l  = x <= lo[i]   + ((c <= PCAV_ALARM_LO)   ? hyst[i] : 0.);
+        int32_t ll = x <= lolo[i] + ((c <= PCAV_ALARM_LOLO) ? hyst[i] : 0.);
+        nxt[i] = hh ? PCAV_ALARM_HIHI : h ? PCAV_ALARM_HI : ll ? PCAV_ALARM_LOLO : l ? PCAV_ALARM_LO : PCAV_ALARM_NONE;
+    }
+
+    size_t added = 0;
+    for(int i = 0; i < n; i++) {
+        if(nxt[i] == cur[i]) continue;
+
+        if(nEvents_ < events_.size()) {
+            pcavAlarmEvent *e = &events_[nEvents_++];
+            e->pulseId = snap.pulseId;
+            e->board   = board;
+            e->channel = i;
+            e->from    = cur[i];
+            e->to      = nxt[i];
+            e->value   = v[i];
+            added++;
+        }
+        else {
+            dropped_++;
+            pcavMetricAdd(PCAV_M_ALARM_DROPPED, 1);
+        }
+        level_[off + i] = nxt[i];
+    }
+    pcavMetricSet(PCAV_M_ALARM_QUEUE_DEPTH, nEvents_);
+
+    return added;
+}
+
+const pcavAlarmEvent *CpcavAlarm::events(size_t *n) const
+{
+    *n = nEvents_;
+
+    return &events_[0];
+}
+
+void CpcavAlarm::clearEvents(void)
+{
+    nEvents_ = 0;
+    pcavMetricSet(PCAV_M_ALARM_QUEUE_DEPTH, 0);
+}
+
+pcavAlarmLevel CpcavAlarm::level(int board, int channel) const
+{
+    if(board < 0 || board >= nBoards_ || channel < 0 || channel >= PCAV_ALARM_NUM_CHANNELS) return PCAV_ALARM_NONE;
+
+    return (pcavAlarmLevel) level_[board * PCAV_ALARM_NUM_CHANNELS + channel];
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVALARM_H
+#define _PCAVALARM_H
+
+#include <vector>
+#include "pcavFw.h"
+
+// alarm channels of one board
+typedef enum {
+    PCAV_ALARM_REF_AMPL = 0,                                               // getRefAmpl
+    PCAV_ALARM_IF_AMPL  = 1,                                               // getIfAmpl, per cavity and probe
+    PCAV_ALARM_OUT_PHASE = PCAV_ALARM_IF_AMPL   + PCAV_NUM_CAVITY * PCAV_NUM_PROBE,   // getOutPhase
+    PCAV_ALARM_DC_FREQ   = PCAV_ALARM_OUT_PHASE + PCAV_NUM_CAVITY * PCAV_NUM_PROBE,   // getDCFreq
+    PCAV_ALARM_NUM_CHANNELS = PCAV_ALARM_DC_FREQ + PCAV_NUM_CAVITY * PCAV_NUM_PROBE
+} pcavAlarmSignal;
+
+typedef enum {
+    PCAV_ALARM_LOLO = -2,
+    PCAV_ALARM_LO   = -1,
+    PCAV_ALARM_NONE = 0,
+    PCAV_ALARM_HI   = 1,
+    PCAV_ALARM_HIHI = 2
+} pcavAlarmLevel;
+
+// set a limit to +/-HUGE_VAL to disable it
+struct pcavAlarmLimits {
+    double    hihi;
+    double    hi;
+    double    lo;
+    double    lolo;
+    double    hyst;            // an active level clears only once the value is hyst back inside the limit
+};
+
+struct pcavAlarmEvent {
+    uint64_t  pulseId;
+    uint16_t  board;
+    uint16_t  channel;
+    int8_t    from;            // pcavAlarmLevel
+    int8_t    to;
+    double    value;
+};
+
+// limit tables are structure of arrays over board x channel, one contiguous row per board
+class CpcavAlarm {
+private:
+    int       nBoards_;
+    std::vector<double>  hihi_, hi_, lo_, lolo_, hyst_;
+    std::vector<double>  value_;
+    std::vector<int32_t> level_;
+    std::vector<int32_t> next_;
+    std::vector<pcavAlarmEvent> events_;    // capacity fixed at construction
+    size_t    nEvents_;
+    uint64_t  dropped_;
+
+public:
+    CpcavAlarm(int nBoards, size_t maxEvents);
+
+    static int channel(pcavAlarmSignal signal, int cavity = 0, int probe = 0);
+
+    void      setLimits(int board, int channel, const pcavAlarmLimits &limits);
+    void      setLimits(int board, pcavAlarmSignal signal, const pcavAlarmLimits &limits);    // all cavities and probes
+
+    // evaluate one board, appends the transitions to the event list, returns the number appended
+    size_t    evaluate(int board, const pcavSnapshot &snap);
+
+    const pcavAlarmEvent *events(size_t *n) const;
+    void      clearEvents(void);
+    uint64_t  dropped(void) const { return dropped_; }    // transitions lost to a full event list
+
+    pcavAlarmLevel level(int board, int channel) const;
+};
+
+#endif /* _PCAVALARM_H */
@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVBUS_H
+#define _PCAVBUS_H
+
+// register access wrapper shared by the adapters, internal to pcavLib, not installed
+// every access is counted in the bus metrics and passes the fault injection hook
+
+#include <cpsw_api_user.h>
+#include <stdio.h>
+#include "pcavMetrics.h"
+#include "pcavFault.h"
+
+// R is the register accessed by R->OP, fault injection rules match its path and are charged
+// the bytes moved, all elements of R, or N elements for a partial array access
+// lookups of a register go through CPSW_TRY_CATCH_AT with the name looked up and no bytes
+#define CPSW_TRY_CATCH(R, OP)       CPSW_TRY_CATCH_N(R, OP, (R)->getNelms())
+#define CPSW_TRY_CATCH_N(R, OP, N)  CPSW_TRY_CATCH_AT((R)->getPath()->toString().c_str(), \
+                                                      (uint64_t) (N) * (((R)->getSizeBits() + 7) / 8), (R)->OP)
+
+#define CPSW_TRY_CATCH_AT(WHERE, BYTES, X)  try {            \
+        pcavMetricAdd(PCAV_M_BUS_TRANSACTIONS, 1);           \
+        if(pcavFaultActive) pcavFaultInject(WHERE, BYTES);   \
+        (X);                                                 \
+    } catch (CPSWError &e) {                                 \
+        pcavMetricAdd(PCAV_M_BUS_ERRORS, 1);                 \
+        fprintf(stderr,                                      \
+                "CPSW Error: %s at %s, line %d\n",           \
+                e.getInfo().c_str(),                         \
+                __FILE__, __LINE__);                         \
+        throw;                                               \
+    }
+
+#endif /* _PCAVBUS_H */
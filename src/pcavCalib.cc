@@ -0,0 +1,192 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavCalib.h"
+#include "pcavUtil.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#define RAD2DEG     (180. / M_PI)
+
+
+CpcavCalib::CpcavCalib(size_t window):
+    window_(window),
+    x_(window), y_(window), w_(window), r_(window), scratch_(window)
+{
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) config_.target[c] = NAN;
+    config_.huberK     = 1.345;
+    config_.iterations = 10;
+    config_.fitOffset  = true;
+    config_.fitCoeff   = true;
+    config_.fitWeight  = true;
+}
+
+void CpcavCalib::setConfig(const pcavCalibConfig &config)
+{
+    config_ = config;
+}
+
+// 1.4826 * median absolute value of r_[]
+double CpcavCalib::robustScale(size_t n)
+{
+    for(size_t i = 0; i < n; i++) scratch_[i] = fabs(r_[i]);
+    std::nth_element(scratch_.begin(), scratch_.begin() + n/2, scratch_.begin() + n);
+
+    return 1.4826 * scratch_[n/2];
+}
+
+// Huber location of y_[], spread gets the robust scale of the residuals
+double CpcavCalib::huberLocation(size_t n, double *spread)
+{
+    double m = 0.;
+
+    for(size_t i = 0; i < n; i++) m += y_[i];
+    m /= n;
+
+    for(int it = 0; it < config_.iterations; it++) {
+        for(size_t i = 0; i < n; i++) r_[i] = y_[i] - m;
+        double k = config_.huberK * robustScale(n);
+        double sw = 0., swy = 0.;
+        for(size_t i = 0; i < n; i++) {
+            double a = fabs(r_[i]);
+            double w = (a <= k || k <= 0.) ? 1. : k / a;
+            sw  += w;
+            swy += w * y_[i];
+        }
+        m = swy / sw;
+    }
+
+    for(size_t i = 0; i < n; i++) r_[i] = y_[i] - m;
+    *spread = robustScale(n);
+
+    return m;
+}
+
+// Huber regression y_ = a + b x_
+void CpcavCalib::huberLine(size_t n, double *a, double *b, double *rms)
+{
+    for(size_t i = 0; i < n; i++) w_[i] = 1.;
+
+    for(int it = 0; it <= config_.iterations; it++) {
+        double sw = 0., sx = 0., sy = 0., sxx = 0., sxy = 0.;
+        for(size_t i = 0; i < n; i++) {
+            sw  += w_[i];
+            sx  += w_[i] * x_[i];
+            sy  += w_[i] * y_[i];
+            sxx += w_[i] * x_[i] * x_[i];
+            sxy += w_[i] * x_[i] * y_[i];
+        }
+        double det = sw * sxx - sx * sx;
+        if(det == 0.) { *b = 0.; *a = sy / sw; }
+        else {
+            *b = (sw * sxy - sx * sy) / det;
+            *a = (sy - *b * sx) / sw;
+        }
+
+        for(size_t i = 0; i < n; i++) r_[i] = y_[i] - *a - *b * x_[i];
+        double k = config_.huberK * robustScale(n);
+        for(size_t i = 0; i < n; i++) {
+            double ar = fabs(r_[i]);
+            w_[i] = (ar <= k || k <= 0.) ? 1. : k / ar;
+        }
+    }
+
+    double ss = 0.;
+    for(size_t i = 0; i < n; i++) ss += r_[i] * r_[i];
+    *rms = sqrt(ss / n);
+}
+
+bool CpcavCalib::solve(const CpcavHistory &history, size_t n, pcavCalibResult *result)
+{
+    if(n > window_) n = window_;
+    if(n > history.size()) n = history.size();
+    if(n < 2) return false;
+
+    memset(result, 0, sizeof(pcavCalibResult));
+    result->pulses = n;
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        double mean[PCAV_NUM_PROBE], var[PCAV_NUM_PROBE];
+
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            // probe phase before the offset, unwrapped around its circular mean
+            history.series(c, p, PCAV_INTEG_I, n, &x_[0]);
+            history.series(c, p, PCAV_INTEG_Q, n, &y_[0]);
+            double s = 0., co = 0.;
+            for(size_t i = 0; i < n; i++) {
+                y_[i] = atan2(y_[i], x_[i]) * RAD2DEG;
+                s  += sin(y_[i] / RAD2DEG);
+                co += cos(y_[i] / RAD2DEG);
+            }
+            double cm = atan2(s, co) * RAD2DEG;
+            for(size_t i = 0; i < n; i++) y_[i] = wrap_phase(y_[i] - cm);
+
+            double spread;
+            mean[p] = wrap_phase(cm + huberLocation(n, &spread));
+            var[p]  = spread * spread;
+            result->phaseRms[c][p] = spread;
+
+            // amplitude to phase: the uncompensated probe phase against IfAmpl, so the fit
+            // does not see the CalibCoeff programmed now and a second run gives the same word
+            if(config_.fitCoeff) {
+                for(size_t i = 0; i < n; i++) y_[i] /= 180.;
+                history.series(c, p, PCAV_IF_AMPL, n, &x_[0]);
+
+                double a, b;
+                huberLine(n, &a, &b, &result->coeffResidual[c][p]);
+                result->calibCoeff[c][p] = -b;
+            }
+        }
+
+        double target = isnan(config_.target[c]) ? mean[0] : config_.target[c];
+
+        // CompPhase is a weighted mean, only the ratio of the weights matters; the 2 bit
+        // register takes 0, 0.5, 1 and 1.5, pick the pair nearest the inverse variance ratio
+        if(config_.fitWeight) {
+            static const uint32_t pair[][2] = { {2, 2}, {3, 2}, {2, 3}, {2, 1}, {1, 2}, {3, 1}, {1, 3} };
+            double ratio = (var[0] > 0. && var[1] > 0.) ? log(var[1] / var[0]) :
+                           (var[0] > 0.) ? -HUGE_VAL : (var[1] > 0.) ? HUGE_VAL : 0.;
+            int    best  = 0;
+            for(int i = 1; i < (int) (sizeof(pair) / sizeof(pair[0])); i++) {
+                if(fabs(log((double) pair[i][0] / pair[i][1]) - ratio) <
+                   fabs(log((double) pair[best][0] / pair[best][1]) - ratio)) best = i;
+            }
+            for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+                result->weightWord[c][p] = pair[best][p];
+                result->weight[c][p]     = pair[best][p] / 2.;
+            }
+        }
+
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            if(config_.fitOffset) result->phaseOffset[c][p] = wrap_phase(target - mean[p]) / 180.;
+
+            // the words setPhaseOffset() and setCalibCoeff() would write, clamped to the field,
+            // the values reported are what the words stand for
+            result->phaseOffsetWord[c][p] = IpcavFw::phaseOffsetWord(result->phaseOffset[c][p]);
+            result->calibCoeffWord[c][p]  = IpcavFw::calibCoeffWord(result->calibCoeff[c][p]);
+            result->phaseOffset[c][p]     = IpcavFw::phaseOffsetValue(result->phaseOffsetWord[c][p]);
+            result->calibCoeff[c][p]      = IpcavFw::calibCoeffValue(result->calibCoeffWord[c][p]);
+        }
+    }
+
+    return true;
+}
+
+void CpcavCalib::apply(pcavFw fw, const pcavCalibResult &result)
+{
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            if(config_.fitOffset) fw->setPhaseOffsetRaw(c, p, result.phaseOffsetWord[c][p]);
+            if(config_.fitCoeff)  fw->setCalibCoeffRaw(c, p,  result.calibCoeffWord[c][p]);
+            if(config_.fitWeight) fw->setWeightRaw(c, p,      result.weightWord[c][p]);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVCALIB_H
+#define _PCAVCALIB_H
+
+#include <vector>
+#include "pcavFw.h"
+#include "pcavHistory.h"
+
+// calibration model, per cavity and probe, phases in degree, PhaseOffset and CalibCoeff in half turns
+//   OutPhase[p]  = atan2(IntegQ, IntegI)[p] + 180 PhaseOffset[p]
+//   comp[p]      = OutPhase[p] + 180 CalibCoeff[p] IfAmpl[p]
+//   CompPhase    = circular mean of comp[] weighted by Weight[], the same in both probe registers
+// the fit
+//   PhaseOffset  rotates the probe phase onto the cavity target phase
+//   CalibCoeff   cancels the slope of the probe phase over IfAmpl
+//   Weight       the 2 bit word pair (0, 0.5, 1, 1.5) nearest the inverse variance ratio of the probes
+// fits are Huber robust (IRLS), so single bad pulses do not pull the result
+// the fit never reads the settings programmed now, a second run reproduces the first
+
+struct pcavCalibConfig {
+    double    target[PCAV_NUM_CAVITY];    // target phase in degree, NAN to align onto probe 0
+    double    huberK;                     // Huber threshold in robust sigma, 1.345 for 95% efficiency
+    int       iterations;                 // IRLS iterations
+    bool      fitOffset;
+    bool      fitCoeff;
+    bool      fitWeight;
+};
+
+struct pcavCalibResult {
+    size_t    pulses;
+    // values as taken by the setters, and the register words they produce
+    double    phaseOffset[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];    // half turns
+    double    calibCoeff[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    weight[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    uint32_t  phaseOffsetWord[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    uint32_t  calibCoeffWord[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    uint32_t  weightWord[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    phaseRms[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];       // robust phase spread, degree
+    double    coeffResidual[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];  // rms of the phase over IfAmpl fit residual, half turns
+};
+
+class CpcavCalib {
+private:
+    size_t    window_;
+    pcavCalibConfig config_;
+    std::vector<double> x_, y_, w_, r_, scratch_;
+
+    double    robustScale(size_t n);
+    double    huberLocation(size_t n, double *spread);
+    void      huberLine(size_t n, double *a, double *b, double *rms);
+
+public:
+    CpcavCalib(size_t window);
+
+    void      setConfig(const pcavCalibConfig &config);
+
+    // fit over the last n snapshots (n <= window), returns false if there are fewer than 2 pulses
+    bool      solve(const CpcavHistory &history, size_t n, pcavCalibResult *result);
+
+    // write all fitted words back-to-back through the raw setters, 12 register writes at most
+    // CPSW has no multi-register transaction and the setting registers are not known to be
+    // contiguous, so the words cannot go out as one block write
+    void      apply(pcavFw fw, const pcavCalibResult &result);
+};
+
+#endif /* _PCAVCALIB_H */
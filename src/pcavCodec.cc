@@ -0,0 +1,283 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavCodec.h"
+
+#include <string.h>
+
+
+#define COL_PULSE_ID   0
+#define COL_TIME       1
+#define COL_FLAGS      2
+#define COL_RETRIES    3
+#define COL_REF        4
+#define COL_PROBE      (COL_REF + PCAV_NUM_REF_FIELDS)
+#define NUM_COL64      2
+#define NUM_COL32      (2 + PCAV_NUM_REF_FIELDS + PCAV_NUM_CAVITY * PCAV_NUM_PROBE * PCAV_NUM_PROBE_FIELDS)
+#define NUM_COLUMNS    (NUM_COL64 + NUM_COL32)
+
+#define MODE_XOR       0x80
+#define WIDTH_MASK     0x7f
+
+
+// packs little endian, low bits first
+struct bitWriter {
+    uint8_t  *p;
+    uint64_t  acc;
+    unsigned  n;
+
+    bitWriter(uint8_t *out): p(out), acc(0), n(0) {}
+
+    void put(uint64_t v, unsigned w)    // w <= 32
+    {
+        acc |= v << n;
+        n += w;
+        while(n >= 8) {
+            *p++ = (uint8_t) acc;
+            acc >>= 8;
+            n -= 8;
+        }
+    }
+    void put64(uint64_t v, unsigned w)
+    {
+        if(w > 32) {
+            put(v & 0xffffffff, 32);
+            put(v >> 32, w - 32);
+        }
+        else put(v, w);
+    }
+    void align(void)
+    {
+        if(n) *p++ = (uint8_t) acc;
+        acc = 0;
+        n   = 0;
+    }
+};
+
+struct bitReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t  acc;
+    unsigned  n;
+
+    bitReader(const uint8_t *in, const uint8_t *e): p(in), end(e), acc(0), n(0) {}
+
+    bool get(unsigned w, uint64_t *v)    // w <= 32
+    {
+        while(n < w) {
+            if(p >= end) return false;
+            acc |= (uint64_t) *p++ << n;
+            n += 8;
+        }
+        *v = w ? (acc & ((uint64_t) -1 >> (64 - w))) : 0;
+        acc >>= w;
+        n -= w;
+        return true;
+    }
+    bool get64(unsigned w, uint64_t *v)
+    {
+        uint64_t lo, hi;
+
+        if(w <= 32) return get(w, v);
+        if(!get(32, &lo) || !get(w - 32, &hi)) return false;
+        *v = lo | (hi << 32);
+        return true;
+    }
+    void align(void)
+    {
+        acc = 0;
+        n   = 0;
+    }
+    bool bytes(void *v, size_t len)
+    {
+        if((size_t) (end - p) < len) return false;
+        memcpy(v, p, len);
+        p += len;
+        return true;
+    }
+};
+
+static inline uint32_t zigzag32(uint32_t d) { return (d << 1) ^ (uint32_t) ((int32_t) d >> 31); }
+static inline uint64_t zigzag64(uint64_t d) { return (d << 1) ^ (uint64_t) ((int64_t) d >> 63); }
+static inline uint32_t unzigzag32(uint32_t z) { return (z >> 1) ^ (uint32_t) -(int32_t) (z & 1); }
+static inline uint64_t unzigzag64(uint64_t z) { return (z >> 1) ^ (uint64_t) -(int64_t) (z & 1); }
+
+static inline unsigned width32(uint32_t v) { return v ? 32 - __builtin_clz(v) : 0; }
+static inline unsigned width64(uint64_t v) { return v ? 64 - __builtin_clzll(v) : 0; }
+
+static inline int32_t *column(pcavSnapshot *s, int k)
+{
+    if(k == COL_FLAGS)   return (int32_t *) &s->flags;
+    if(k == COL_RETRIES) return (int32_t *) &s->retries;
+    if(k < COL_PROBE)  return &s->refRaw[k - COL_REF];
+
+    return &s->raw[0][0][0] + (k - COL_PROBE);
+}
+
+
+CpcavCodec::CpcavCodec(unsigned maxCount):
+    maxCount_(maxCount ? maxCount : 1),
+    col64_(NUM_COL64 * maxCount_),
+    col32_(NUM_COL32 * maxCount_),
+    zz_(maxCount_)
+{
+}
+
+size_t CpcavCodec::maxBlockBytes(unsigned count)
+{
+    return sizeof(pcavCodecHeader) +
+           NUM_COL64 * (2 * sizeof(uint64_t) + 1 + (size_t) count * sizeof(uint64_t)) +
+           NUM_COL32 * (sizeof(uint32_t) + 1 + (size_t) count * sizeof(uint32_t));
+}
+
+size_t CpcavCodec::encode(const pcavSnapshot *snap, unsigned count, uint8_t *out)
+{
+    if(count == 0 || count > maxCount_) return 0;
+
+    // transpose into columns, the transforms below run over contiguous words
+    // GCC vectorizes the delta of deltas and the OR reductions at -O3, at -O2 all loops here stay scalar
+    // there is no hand-written SIMD path: the bit packing is serial through the writer position and
+    // costs more than the transforms, and intrinsics would tie the codec to one instruction set
+    int64_t  *pid  = &col64_[0];
+    int64_t  *time = &col64_[maxCount_];
+    for(unsigned i = 0; i < count; i++) {
+        pid[i]  = (int64_t) snap[i].pulseId;
+        time[i] = (int64_t) snap[i].ts.tv_sec * 1000000000 + snap[i].ts.tv_nsec;
+        for(int k = COL_FLAGS; k < NUM_COLUMNS; k++) col32_[(k - COL_FLAGS) * maxCount_ + i] = *column((pcavSnapshot *) &snap[i], k);
+    }
+
+    pcavCodecHeader hdr;
+    hdr.magic        = PCAV_CODEC_MAGIC;
+    hdr.version      = PCAV_CODEC_VERSION;
+    hdr.columns      = NUM_COLUMNS;
+    hdr.count        = count;
+    hdr.firstPulseId = snap[0].pulseId;
+    hdr.lastPulseId  = snap[count - 1].pulseId;
+    hdr.firstTime    = time[0];
+    hdr.lastTime     = time[count - 1];
+
+    bitWriter w(out + sizeof(hdr));
+
+    // pulse ID and time, delta of deltas
+    for(int k = 0; k < NUM_COL64; k++) {
+        const int64_t *x = &col64_[k * maxCount_];
+        uint64_t first = x[0];
+        uint64_t delta = count > 1 ? (uint64_t) x[1] - x[0] : 0;
+        uint64_t all   = 0;
+
+        for(unsigned i = 2; i < count; i++) {
+            zz_[i] = zigzag64(((uint64_t) x[i] - x[i - 1]) - ((uint64_t) x[i - 1] - x[i - 2]));
+            all |= zz_[i];
+        }
+        unsigned bits = width64(all);
+
+        memcpy(w.p, &first, sizeof(first)); w.p += sizeof(first);
+        memcpy(w.p, &delta, sizeof(delta)); w.p += sizeof(delta);
+        *w.p++ = (uint8_t) bits;
+        for(unsigned i = 2; i < count; i++) w.put64(zz_[i], bits);
+        w.align();
+    }
+
+    // flags, retries and register words, delta or XOR with the previous pulse
+    for(int k = 0; k < NUM_COL32; k++) {
+        const uint32_t *x = &col32_[k * maxCount_];
+        uint32_t orDelta = 0, orXor = 0;
+
+        for(unsigned i = 1; i < count; i++) {
+            orDelta |= zigzag32(x[i] - x[i - 1]);
+            orXor   |= x[i] ^ x[i - 1];
+        }
+        bool     useXor = width32(orXor) < width32(orDelta);
+        unsigned bits   = useXor ? width32(orXor) : width32(orDelta);
+
+        memcpy(w.p, &x[0], sizeof(uint32_t)); w.p += sizeof(uint32_t);
+        *w.p++ = (uint8_t) (bits | (useXor ? MODE_XOR : 0));
+        if(bits) {
+            if(useXor) for(unsigned i = 1; i < count; i++) w.put(x[i] ^ x[i - 1], bits);
+            else       for(unsigned i = 1; i < count; i++) w.put(zigzag32(x[i] - x[i - 1]), bits);
+        }
+        w.align();
+    }
+
+    hdr.bytes = (uint32_t) (w.p - out);
+    memcpy(out, &hdr, sizeof(hdr));
+
+    return hdr.bytes;
+}
+
+int CpcavCodec::peek(const uint8_t *in, size_t len, pcavCodecHeader *hdr)
+{
+    if(len < sizeof(*hdr)) return -1;
+    memcpy(hdr, in, sizeof(*hdr));
+    if(hdr->magic != PCAV_CODEC_MAGIC || hdr->version != PCAV_CODEC_VERSION ||
+       hdr->columns != NUM_COLUMNS || hdr->count == 0 || hdr->bytes > len || hdr->bytes < sizeof(*hdr)) return -1;
+
+    return 0;
+}
+
+int CpcavCodec::decode(const uint8_t *in, size_t len, pcavSnapshot *snap)
+{
+    pcavCodecHeader hdr;
+
+    if(peek(in, len, &hdr) || hdr.count > maxCount_) return -1;
+
+    unsigned  count = hdr.count;
+    bitReader r(in + sizeof(hdr), in + hdr.bytes);
+
+    for(int k = 0; k < NUM_COL64; k++) {
+        uint64_t x, delta, z;
+        uint8_t  bits;
+
+        if(!r.bytes(&x, sizeof(x)) || !r.bytes(&delta, sizeof(delta)) || !r.bytes(&bits, 1) || bits > 64) return -1;
+        for(unsigned i = 0; i < count; i++) {
+            if(i >= 2) {
+                if(!r.get64(bits, &z)) return -1;
+                delta += unzigzag64(z);
+            }
+            if(i >= 1) x += delta;
+            if(k == COL_PULSE_ID) snap[i].pulseId = x;
+            else {
+                snap[i].ts.tv_sec  = (int64_t) x / 1000000000;
+                snap[i].ts.tv_nsec = (int64_t) x % 1000000000;
+            }
+        }
+        r.align();
+    }
+
+    for(int k = COL_FLAGS; k < NUM_COLUMNS; k++) {
+        uint32_t x;
+        uint64_t z;
+        uint8_t  mode;
+
+        if(!r.bytes(&x, sizeof(x)) || !r.bytes(&mode, 1)) return -1;
+        unsigned bits = mode & WIDTH_MASK;
+        if(bits > 32) return -1;
+        for(unsigned i = 0; i < count; i++) {
+            if(i >= 1) {
+                if(!r.get(bits, &z)) return -1;
+                x = (mode & MODE_XOR) ? x ^ (uint32_t) z : x + unzigzag32((uint32_t) z);
+            }
+            *column(&snap[i], k) = (int32_t) x;
+        }
+        r.align();
+    }
+
+    for(unsigned i = 0; i < count; i++) {
+        for(int f = 0; f < PCAV_NUM_REF_FIELDS; f++) snap[i].ref[f] = IpcavFw::convert((pcavRefField) f, snap[i].refRaw[f]);
+        for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+            for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+                for(int f = 0; f < PCAV_NUM_PROBE_FIELDS; f++) {
+                    snap[i].val[c][p][f] = IpcavFw::convert((pcavProbeField) f, snap[i].raw[c][p][f]);
+                }
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVCODEC_H
+#define _PCAVCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "pcavFw.h"
+
+#define PCAV_CODEC_MAGIC     0x7063627a     // 'pcbz'
+#define PCAV_CODEC_VERSION   2          // 2 adds the retries column
+
+// lossless block codec for the raw register words of consecutive snapshots
+// a block stands alone, it is decodable without the blocks before it
+//
+// layout: header, then one column per field, pulse ID, timestamp, flags, retries, reference and probe words
+//   pulse ID and timestamp: first value, first delta, delta of deltas
+//   flags, retries and register words: first value, deltas or XOR with the previous pulse, whichever packs smaller
+// every column after its first values is one mode/width byte and the zig-zag coded words,
+// bit-packed at that width and padded to a byte
+struct pcavCodecHeader {
+    uint32_t  magic;
+    uint16_t  version;
+    uint16_t  columns;
+    uint32_t  count;           // snapshots in the block
+    uint32_t  bytes;           // block size including this header
+    uint64_t  firstPulseId;
+    uint64_t  lastPulseId;
+    int64_t   firstTime;       // ns since the epoch
+    int64_t   lastTime;
+};
+
+class CpcavCodec {
+private:
+    unsigned  maxCount_;
+    std::vector<int64_t>  col64_;      // column staging, maxCount_ entries per column
+    std::vector<uint32_t> col32_;
+    std::vector<uint64_t> zz_;
+
+public:
+    // maxCount bounds the snapshots per block, all scratch is allocated here
+    CpcavCodec(unsigned maxCount);
+
+    unsigned  maxCount(void) const { return maxCount_; }
+    static size_t maxBlockBytes(unsigned count);
+
+    // encode count snapshots (raw words, pulse ID, time, flags, retries) into out, returns the block size, 0 on error
+    size_t    encode(const pcavSnapshot *snap, unsigned count, uint8_t *out);
+
+    // decode one block, values are converted from the raw words, returns the number of snapshots or -1
+    int       decode(const uint8_t *in, size_t len, pcavSnapshot *snap);
+
+    // check and return the header of the block at in, 0 if it is a valid header
+    static int peek(const uint8_t *in, size_t len, pcavCodecHeader *hdr);
+};
+
+#endif /* _PCAVCODEC_H */
@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavCodec.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// encode/decode round trip of CpcavCodec, exits non-zero on the first mismatch
+
+#define MAX_COUNT  256
+
+static pcavSnapshot in[MAX_COUNT], out[MAX_COUNT];
+
+static void fill(unsigned count, unsigned seed)
+{
+    memset(in, 0, sizeof(in));
+    srand(seed);
+    for(unsigned i = 0; i < count; i++) {
+        in[i].pulseId     = 1000 + 3 * i;
+        in[i].ts.tv_sec   = 1700000000 + i / 120;
+        in[i].ts.tv_nsec  = (i % 120) * 8333333;
+        in[i].flags       = (i & 1) ? PCAV_SNAP_COHERENT : PCAV_SNAP_TORN;
+        in[i].retries     = rand() % 4;
+        for(int f = 0; f < PCAV_NUM_REF_FIELDS; f++) in[i].refRaw[f] = rand() % 7 - 3;
+        for(int c = 0; c < PCAV_NUM_CAVITY; c++)
+            for(int p = 0; p < PCAV_NUM_PROBE; p++)
+                for(int f = 0; f < PCAV_NUM_PROBE_FIELDS; f++) in[i].raw[c][p][f] = (int32_t) (rand() % 65536) - 32768;
+    }
+}
+
+static int roundTrip(const char *name, unsigned count)
+{
+    CpcavCodec codec(MAX_COUNT);
+    std::vector<uint8_t> buf(CpcavCodec::maxBlockBytes(count));
+    pcavCodecHeader hdr;
+
+    memset(out, 0xa5, sizeof(out));
+    size_t n = codec.encode(in, count, &buf[0]);
+    if(!n || n > buf.size() || CpcavCodec::peek(&buf[0], n, &hdr) || hdr.count != count) {
+        printf("%s: encode failed\n", name);
+        return -1;
+    }
+    if(codec.decode(&buf[0], n, out) != (int) count) {
+        printf("%s: decode failed\n", name);
+        return -1;
+    }
+
+    for(unsigned i = 0; i < count; i++) {
+        if(in[i].pulseId != out[i].pulseId ||
+           in[i].ts.tv_sec != out[i].ts.tv_sec || in[i].ts.tv_nsec != out[i].ts.tv_nsec ||
+           in[i].flags != out[i].flags || in[i].retries != out[i].retries ||
+           memcmp(in[i].refRaw, out[i].refRaw, sizeof(in[i].refRaw)) ||
+           memcmp(in[i].raw, out[i].raw, sizeof(in[i].raw))) {
+            printf("%s: snapshot %u of %u differs\n", name, i, count);
+            return -1;
+        }
+    }
+    printf("%s: %u snapshots, %zu bytes\n", name, count, n);
+
+    return 0;
+}
+
+int main(void)
+{
+    int err = 0;
+
+    // a single snapshot carries first values only, two add the first delta but no delta of deltas
+    fill(1, 1);
+    err |= roundTrip("count 1", 1);
+    fill(2, 2);
+    err |= roundTrip("count 2", 2);
+
+    fill(MAX_COUNT, 3);
+    err |= roundTrip("random words", MAX_COUNT);
+
+    // pulse IDs 0, 0, 2^62 repeated, a delta of deltas of -2^63 needs the full 64 bit width
+    fill(MAX_COUNT, 4);
+    for(unsigned i = 0; i < MAX_COUNT; i++) in[i].pulseId = (i % 3 == 2) ? (uint64_t) 1 << 62 : 0;
+    err |= roundTrip("64 bit delta of deltas", MAX_COUNT);
+
+    // a word toggling its low bit on top of a large value packs smaller as XOR,
+    // a word counting up across powers of two packs smaller as delta
+    fill(MAX_COUNT, 5);
+    for(unsigned i = 0; i < MAX_COUNT; i++) {
+        in[i].raw[0][0][PCAV_IF_AMPL]  = 0x40000000 | (i & 1);
+        in[i].raw[1][1][PCAV_DC_FREQ]  = 0x7f00 + (int32_t) i;
+        in[i].refRaw[PCAV_REF_PHASE]   = -(int32_t) i;
+    }
+    err |= roundTrip("XOR and delta columns", MAX_COUNT);
+
+    // constant columns pack to zero width
+    fill(MAX_COUNT, 6);
+    for(unsigned i = 1; i < MAX_COUNT; i++) {
+        memcpy(in[i].raw, in[0].raw, sizeof(in[0].raw));
+        memcpy(in[i].refRaw, in[0].refRaw, sizeof(in[0].refRaw));
+        in[i].retries = in[0].retries;
+    }
+    err |= roundTrip("constant words", MAX_COUNT);
+
+    return err ? 1 : 0;
+}
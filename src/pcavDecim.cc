@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavDecim.h"
+
+#include <string.h>
+#include <math.h>
+
+
+CpcavDecimator::CpcavDecimator(const pcavDecimConfig &config, size_t maxFrame):
+    config_(config),
+    maxFrame_(maxFrame),
+    next_(0)
+{
+    if(config_.cicRate < 1)   config_.cicRate = 1;
+    if(config_.cicStages < 1) config_.cicStages = 1;
+    if(config_.firRate < 1)   config_.firRate = 1;
+    if(config_.firTaps < 1)   config_.firTaps = 1;
+    if(config_.cutoff <= 0. || config_.cutoff > 1.) config_.cutoff = 0.8;
+
+    integ_.resize(config_.cicStages);
+    comb_.resize(config_.cicStages);
+    cicGain_ = pow((double) config_.cicRate, config_.cicStages);
+    cicOut_.resize(maxFrame / config_.cicRate + 1);
+
+    coeff_.resize(config_.firTaps);
+    if(config_.coeff) {
+        for(int k = 0; k < config_.firTaps; k++) coeff_[k] = config_.coeff[config_.firTaps - 1 - k];
+    }
+    else {
+        std::vector<float> h(config_.firTaps);
+        design(&h[0], config_.firTaps, config_.cutoff / config_.firRate);
+        for(int k = 0; k < config_.firTaps; k++) coeff_[k] = h[config_.firTaps - 1 - k];
+    }
+    config_.coeff = 0;    // not owned
+
+    hist_.resize(config_.firTaps - 1 + maxFrame / config_.cicRate + 1);
+
+    reset();
+}
+
+void CpcavDecimator::reset(void)
+{
+    for(int i = 0; i < config_.cicStages; i++) integ_[i] = comb_[i] = 0;
+    cicPhase_ = 0;
+
+    for(size_t i = 0; i < hist_.size(); i++) hist_[i] = 0.f;
+    histLen_  = config_.firTaps - 1;
+    firPhase_ = 0;
+
+    if(next_) next_->reset();
+}
+
+void CpcavDecimator::setNext(CpcavDecimator *next)
+{
+    next_ = next;
+    nextIn_.resize(maxFrame_ / rate() + 2);
+}
+
+size_t CpcavDecimator::maxOutput(void) const
+{
+    size_t n = maxFrame_ / rate() + 2;
+
+    return next_ ? next_->maxOutput() : n;
+}
+
+void CpcavDecimator::design(float *coeff, int taps, double cutoff)
+{
+    double m = taps - 1;
+    double sum = 0.;
+
+    for(int k = 0; k < taps; k++) {
+        double x = k - m / 2.;
+        double s = (x == 0.) ? cutoff : sin(M_PI * cutoff * x) / (M_PI * x);
+        double w = (taps > 1) ? 0.42 - 0.5 * cos(2. * M_PI * k / m) + 0.08 * cos(4. * M_PI * k / m) : 1.;
+        coeff[k] = (float) (s * w);
+        sum += s * w;
+    }
+    for(int k = 0; k < taps; k++) coeff[k] = (float) (coeff[k] / sum);    // unity gain at DC
+}
+
+size_t CpcavDecimator::cic(const int32_t *in, size_t n, double scale, float *out)
+{
+    const int N = config_.cicStages;
+    size_t m = 0;
+
+    for(size_t i = 0; i < n; i++) {
+        uint64_t x = (uint64_t) (int64_t) in[i];
+        for(int s = 0; s < N; s++) x = integ_[s] += x;
+
+        if(++cicPhase_ < config_.cicRate) continue;
+        cicPhase_ = 0;
+
+        for(int s = 0; s < N; s++) {
+            uint64_t y = x - comb_[s];
+            comb_[s] = x;
+            x = y;
+        }
+        out[m++] = (float) ((int64_t) x / cicGain_ * scale);
+    }
+
+    return m;
+}
+
+size_t CpcavDecimator::fir(const float *in, size_t n, float *out)
+{
+    const int T = config_.firTaps;
+    const int D = config_.firRate;
+    float *h = &hist_[0];
+    size_t m = 0;
+
+    memcpy(h + histLen_, in, n * sizeof(float));
+    size_t len = histLen_ + n;
+
+    // output only where the polyphase phase lands, each one a contiguous dot product,
+    // independent lanes so the float sum vectorizes without reassociation
+    const float *c = &coeff_[0];
+    const int    T0 = T - T % PCAV_DECIM_LANES;
+    size_t i = T - 1 + ((D - firPhase_) % D);
+    for(; i < len; i += D) {
+        const float *x = h + i - (T - 1);
+        float acc[PCAV_DECIM_LANES] = { 0.f };
+        for(int k = 0; k < T0; k += PCAV_DECIM_LANES) {
+            for(int l = 0; l < PCAV_DECIM_LANES; l++) acc[l] += c[k + l] * x[k + l];
+        }
+        float sum = 0.f;
+        for(int l = 0; l < PCAV_DECIM_LANES; l++) sum += acc[l];
+        for(int k = T0; k < T; k++) sum += c[k] * x[k];
+        out[m++] = sum;
+    }
+    firPhase_ = (firPhase_ + n) % D;
+
+    // keep the tail for the next frame
+    memmove(h, h + len - (T - 1), (T - 1) * sizeof(float));
+    histLen_ = T - 1;
+
+    return m;
+}
+
+size_t CpcavDecimator::forward(float *out, size_t n, float *final)
+{
+    if(!next_) {
+        if(final != out) memcpy(final, out, n * sizeof(float));
+        return n;
+    }
+
+    return next_->process(out, n, final);
+}
+
+size_t CpcavDecimator::process(const int16_t *in, size_t n, float *out)
+{
+    if(n > maxFrame_) n = maxFrame_;
+
+    float *stage = next_ ? &nextIn_[0] : out;
+    size_t m;
+
+    if(config_.cicRate > 1) {
+        // widen to int32 in blocks for the integrators
+        int32_t buf[256];
+        m = 0;
+        for(size_t i = 0; i < n; i += 256) {
+            size_t b = (n - i < 256) ? n - i : 256;
+            for(size_t k = 0; k < b; k++) buf[k] = in[i + k];
+            m += cic(buf, b, 1. / 32768., &cicOut_[m]);
+        }
+        m = fir(&cicOut_[0], m, stage);
+    }
+    else {
+        float *f = &cicOut_[0];
+        for(size_t k = 0; k < n; k++) f[k] = in[k] / 32768.f;
+        m = fir(f, n, stage);
+    }
+
+    return forward(stage, m, out);
+}
+
+size_t CpcavDecimator::process(const float *in, size_t n, float *out)
+{
+    if(n > maxFrame_) n = maxFrame_;
+
+    float *stage = next_ ? &nextIn_[0] : out;
+    size_t m;
+
+    if(config_.cicRate > 1) {
+        // CIC needs integers, float samples are taken as fixed 1.23, clamped to the int32 range
+        int32_t buf[256];
+        m = 0;
+        for(size_t i = 0; i < n; i += 256) {
+            size_t b = (n - i < 256) ? n - i : 256;
+            for(size_t k = 0; k < b; k++) {
+                double v = in[i + k] * 8388608.;
+                if(!(v > -2147483648.)) v = isnan(v) ? 0. : -2147483648.;
+                if(v > 2147483647.) v = 2147483647.;
+                buf[k] = (int32_t) lrint(v);
+            }
+            m += cic(buf, b, 1. / 8388608., &cicOut_[m]);
+        }
+        m = fir(&cicOut_[0], m, stage);
+    }
+    else m = fir(in, n, stage);
+
+    return forward(stage, m, out);
+}
@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVDECIM_H
+#define _PCAVDECIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define PCAV_DECIM_LANES   8       // independent FIR accumulators, one SIMD register of floats
+
+// decimator for one wfData channel: optional CIC stage followed by a polyphase FIR stage
+// filter state persists across frames, so consecutive frames filter as one stream
+struct pcavDecimConfig {
+    int       cicRate;         // CIC decimation, 1 to bypass
+    int       cicStages;       // CIC order
+    int       firRate;         // FIR decimation, 1 for filtering only
+    int       firTaps;         // number of taps, designed when coeff is 0
+    const float *coeff;        // optional FIR coefficients, firTaps entries
+    double    cutoff;          // designed FIR cutoff as fraction of the output Nyquist rate, e.g. 0.8
+};
+
+class CpcavDecimator {
+private:
+    pcavDecimConfig config_;
+    size_t    maxFrame_;
+
+    // CIC, integer arithmetic, wrap-around in the integrators cancels in the combs,
+    // unsigned so the wrap-around is defined
+    std::vector<uint64_t> integ_;
+    std::vector<uint64_t> comb_;
+    int       cicPhase_;
+    double    cicGain_;
+    std::vector<float>   cicOut_;
+
+    // FIR, coefficients stored reversed, history keeps the last firTaps-1 samples in front of the frame
+    std::vector<float>   coeff_;
+    std::vector<float>   hist_;
+    size_t    histLen_;
+    int       firPhase_;
+
+    CpcavDecimator *next_;
+    std::vector<float>   nextIn_;
+
+    size_t    cic(const int32_t *in, size_t n, double scale, float *out);
+    size_t    fir(const float *in, size_t n, float *out);
+    size_t    forward(float *out, size_t n, float *final);
+
+public:
+    // maxFrame bounds the samples per process() call, all buffers are allocated here
+    CpcavDecimator(const pcavDecimConfig &config, size_t maxFrame);
+
+    int       rate(void) const { return config_.cicRate * config_.firRate; }
+    size_t    maxOutput(void) const;      // upper bound of samples from one process() call, with the chain
+    void      reset(void);
+
+    // feed this stage's output into another decimator, process() then returns the output of the last stage
+    // the next stage needs a maxFrame of at least maxOutput() of this one
+    void      setNext(CpcavDecimator *next);
+
+    // returns the number of samples written to out
+    // float input with a CIC stage is taken as fixed 1.23 and clamped to +/-256
+    size_t    process(const int16_t *in, size_t n, float *out);
+    size_t    process(const float *in, size_t n, float *out);
+
+    // windowed sinc (Blackman) low pass, cutoff as fraction of the sample rate / 2
+    static void design(float *coeff, int taps, double cutoff);
+};
+
+#endif /* _PCAVDECIM_H */
@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavFault.h"
+#include "pcavUtil.h"
+
+#include <cpsw_api_user.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+
+#define SITE_SLOTS  512        // registers cached per rule set, more registers are matched every time
+#define SITE_PATH   128        // longer paths are matched every time
+
+volatile bool pcavFaultActive = false;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pcavFaultRule   rules[PCAV_FAULT_MAX_RULES];
+static pcavFaultStats  stats[PCAV_FAULT_MAX_RULES];
+static uint64_t        nextFree[PCAV_FAULT_MAX_RULES];    // bandwidth cap, ns monotonic
+static int             nRules = 0;
+static uint64_t        rng = 0x853c49e6748fea9bULL;
+
+static struct {
+    uint64_t    hash;
+    char        access[SITE_PATH];    // empty for a free slot
+    int         rule;                 // -1 for no match
+} site[SITE_SLOTS];
+
+
+pcavFaultRule::pcavFaultRule()
+{
+    memset(this, 0, sizeof(*this));
+    strcpy(pattern, "*");
+    dist  = PCAV_FAULT_FIXED;
+    alpha = 3.;
+}
+
+// xorshift64*, uniform in [0, 1)
+static double uniform(void)
+{
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+
+    return ((rng * 0x2545f4914f6cdd1dULL) >> 11) * (1. / 9007199254740992.);
+}
+
+static double latency(const pcavFaultRule &r)
+{
+    double u = uniform();
+
+    switch(r.dist) {
+        case PCAV_FAULT_UNIFORM:     return 2. * r.latencyUs * u;
+        case PCAV_FAULT_EXPONENTIAL: return -r.latencyUs * log(1. - u);
+        case PCAV_FAULT_PARETO: {
+            double a = r.alpha > 1. ? r.alpha : 1.01;
+            return r.latencyUs * (a - 1.) / a / pow(1. - u, 1. / a);
+        }
+        default:                     return r.latencyUs;
+    }
+}
+
+static int match_rules(const char *access)
+{
+    for(int j = 0; j < nRules; j++) if(!fnmatch(rules[j].pattern, access, 0)) return j;
+
+    return -1;
+}
+
+// the result per register path is cached, fnmatch() runs once per register and rule set
+static int match(const char *access)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;    // FNV-1a
+    size_t   len;
+
+    for(len = 0; access[len]; len++) {
+        h ^= (unsigned char) access[len];
+        h *= 0x100000001b3ULL;
+    }
+    if(!len || len >= SITE_PATH) return match_rules(access);
+
+    for(size_t k = 0; k < SITE_SLOTS; k++) {
+        size_t i = (h + k) % SITE_SLOTS;
+        if(site[i].hash == h && !strcmp(site[i].access, access)) return site[i].rule;
+        if(!site[i].access[0]) {
+            site[i].hash = h;
+            memcpy(site[i].access, access, len + 1);
+            site[i].rule = match_rules(access);
+            return site[i].rule;
+        }
+    }
+
+    return match_rules(access);
+}
+
+void pcavFaultInject(const char *access, uint64_t bytes)
+{
+    uint64_t delay = 0;
+    int      fault = 0;    // 1 error, 2 timeout
+
+    pthread_mutex_lock(&lock);
+    int r = match(access);
+    if(r >= 0) {
+        const pcavFaultRule &rule = rules[r];
+        double u = uniform();
+
+        stats[r].matched++;
+        delay = (uint64_t) (latency(rule) * 1000.);
+        if(u < rule.errorRate) {
+            fault = 1;
+            stats[r].errors++;
+        }
+        else if(u < rule.errorRate + rule.timeoutRate) {
+            fault = 2;
+            delay = (uint64_t) (rule.timeoutUs * 1000.);
+            stats[r].timeouts++;
+        }
+        if(rule.bytesPerSec > 0.) {
+            uint64_t now   = now_ns();
+            uint64_t start = nextFree[r] > now ? nextFree[r] : now;
+            nextFree[r] = start + (uint64_t) (bytes * 1.E+9 / rule.bytesPerSec);
+            delay += nextFree[r] - now;
+        }
+        stats[r].delayUs += delay / 1000;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if(delay) sleep_ns(delay);
+    if(fault == 1) throw IOError("pcavFault: injected I/O error");
+    if(fault == 2) throw TimeoutError("pcavFault: injected timeout");
+}
+
+int pcavFaultAddRule(const pcavFaultRule &rule)
+{
+    int r = -1;
+
+    pthread_mutex_lock(&lock);
+    if(nRules < PCAV_FAULT_MAX_RULES) {
+        r = nRules++;
+        rules[r] = rule;
+        rules[r].pattern[sizeof(rules[r].pattern) - 1] = '\0';
+        memset(&stats[r], 0, sizeof(stats[r]));
+        nextFree[r] = 0;
+        memset(site, 0, sizeof(site));    // earlier rules keep precedence, unmatched sites may match now
+    }
+    pthread_mutex_unlock(&lock);
+
+    return r;
+}
+
+void pcavFaultClear(void)
+{
+    pthread_mutex_lock(&lock);
+    nRules = 0;
+    memset(site, 0, sizeof(site));
+    pthread_mutex_unlock(&lock);
+}
+
+void pcavFaultSeed(uint64_t seed)
+{
+    pthread_mutex_lock(&lock);
+    rng = seed ? seed : 0x853c49e6748fea9bULL;    // xorshift state must not be 0
+    pthread_mutex_unlock(&lock);
+}
+
+void pcavFaultEnable(bool enable)
+{
+    pcavFaultActive = enable;
+}
+
+int pcavFaultGetStats(int rule, pcavFaultStats *s)
+{
+    int status = -1;
+
+    pthread_mutex_lock(&lock);
+    if(rule >= 0 && rule < nRules) {
+        *s = stats[rule];
+        status = 0;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return status;
+}
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVFAULT_H
+#define _PCAVFAULT_H
+
+#include <stdint.h>
+
+// fault and latency injection on the register accesses of CpcavFwAdapt, CdacSigGenFwAdapt and CpcavPulseSync
+// the adapters call pcavFaultInject() before every access while injection is enabled, with the
+// CPSW path of the register, e.g. ".../AppTop/AppCore/Sysgen/PcavReg/cav1P1OutPhase", and the bytes
+// transferred, or with the name looked up and 0 bytes when a register is resolved at run time
+// (latch counter, DAC checksum)
+// rules are matched in order with fnmatch(), the first match applies, the result is cached per path
+// all randomness comes from one seeded generator, a single poll thread replays exactly
+
+typedef enum {
+    PCAV_FAULT_FIXED,          // latency = mean
+    PCAV_FAULT_UNIFORM,        // 0 .. 2 mean
+    PCAV_FAULT_EXPONENTIAL,
+    PCAV_FAULT_PARETO          // heavy tail with shape alpha > 1, same mean
+} pcavFaultDist;
+
+struct pcavFaultRule {
+    char      pattern[64];     // e.g. "*OutPhase", "*/PcavReg/cav2*", "*Waveform\\[1\\]*" for the DAC Q table
+    pcavFaultDist dist;
+    double    latencyUs;       // mean added latency
+    double    alpha;           // Pareto shape
+    double    errorRate;       // probability of an IOError
+    double    timeoutRate;     // probability of a stall of timeoutUs followed by a TimeoutError
+    double    timeoutUs;
+    double    bytesPerSec;     // bandwidth cap shared by the accesses of this rule, 0 for none
+
+    pcavFaultRule();
+};
+
+struct pcavFaultStats {
+    uint64_t  matched;
+    uint64_t  errors;
+    uint64_t  timeouts;
+    uint64_t  delayUs;         // total injected latency including bandwidth waits
+};
+
+#define PCAV_FAULT_MAX_RULES  16
+
+extern volatile bool pcavFaultActive;
+
+void pcavFaultInject(const char *path, uint64_t bytes);
+
+int  pcavFaultAddRule(const pcavFaultRule &rule);     // returns the rule index or -1
+void pcavFaultClear(void);
+void pcavFaultSeed(uint64_t seed);
+void pcavFaultEnable(bool enable);
+int  pcavFaultGetStats(int rule, pcavFaultStats *stats);
+
+#endif /* _PCAVFAULT_H */
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavFeedback.h"
+#include "pcavUtil.h"
+#include "pcavNco.h"
+
+#include <string.h>
+#include <math.h>
+
+
+CpcavFeedback::CpcavFeedback(pcavFw fw):
+    fw_(fw)
+{
+    memset(cfg_, 0, sizeof(cfg_));
+    memset(state_, 0, sizeof(state_));
+    for(int c = 0; c < PCAV_FB_NUM_CAVITY; c++) {
+        cfg_[c].dt = 1./120.;
+        reset(c);
+    }
+}
+
+void CpcavFeedback::configure(int cavity, const pcavFbConfig &cfg)
+{
+    if(cavity < 0 || cavity >= PCAV_FB_NUM_CAVITY) return;
+
+    cfg_[cavity] = cfg;
+    if(cfg_[cavity].nGainSched < 0) cfg_[cavity].nGainSched = 0;
+    if(cfg_[cavity].nGainSched > PCAV_FB_MAX_GAINSCHED) cfg_[cavity].nGainSched = PCAV_FB_MAX_GAINSCHED;
+    if(cfg_[cavity].dt <= 0.) cfg_[cavity].dt = 1./120.;
+    reset(cavity);
+}
+
+void CpcavFeedback::enable(int cavity, bool enable)
+{
+    if(cavity < 0 || cavity >= PCAV_FB_NUM_CAVITY) return;
+
+    if(enable && !state_[cavity].enabled) reset(cavity);    // bumpless start from the base value
+    state_[cavity].enabled = enable;
+}
+
+void CpcavFeedback::reset(int cavity)
+{
+    if(cavity < 0 || cavity >= PCAV_FB_NUM_CAVITY) return;
+
+    bool enabled = state_[cavity].enabled;
+    memset(&state_[cavity], 0, sizeof(pcavFbState));
+    state_[cavity].enabled = enabled;
+    lastMeas_[cavity] = NAN;
+}
+
+uint32_t CpcavFeedback::toWord(int cavity, double out)
+{
+    pcavFbConfig *c = &cfg_[cavity];
+
+    switch(c->actuator) {
+        case PCAV_FB_NCO:
+            return pcavNcoWord(c->outBase + out, (c->ncoRefClock > 0.) ? c->ncoRefClock : PCAV_NCO_REF_CLOCK);
+        case PCAV_FB_PHASE_OFFSET:
+            return IpcavFw::phaseOffsetWord((c->outBase + out) / 180.);
+    }
+
+    return 0;
+}
+
+void CpcavFeedback::write(int cavity, uint32_t word)
+{
+    switch(cfg_[cavity].actuator) {
+        case PCAV_FB_NCO:
+            fw_->setNCORaw(cavity, word);
+            break;
+        case PCAV_FB_PHASE_OFFSET:
+            fw_->setPhaseOffsetRaw(cavity, cfg_[cavity].probe, word);
+            break;
+    }
+}
+
+double CpcavFeedback::step(int cavity, double phase)
+{
+    if(cavity < 0 || cavity >= PCAV_FB_NUM_CAVITY) return 0.;
+
+    pcavFbConfig *c = &cfg_[cavity];
+    pcavFbState  *s = &state_[cavity];
+
+    if(!s->enabled || isnan(phase)) return s->out;
+
+    double err = wrap_phase(c->setpoint - phase);
+    double kp = c->kp, ki = c->ki, kd = c->kd;
+
+    for(int i = 0; i < c->nGainSched; i++) {
+        if(fabs(err) < c->gainSched[i].absError) break;
+        kp = c->gainSched[i].kp;
+        ki = c->gainSched[i].ki;
+        kd = c->gainSched[i].kd;
+    }
+
+    // derivative on the measurement, no kick on setpoint changes
+    double deriv = isnan(lastMeas_[cavity]) ? 0. : -wrap_phase(phase - lastMeas_[cavity]) / c->dt;
+    lastMeas_[cavity] = phase;
+
+    double integ = s->integ + ki * err * c->dt;
+    double out   = kp * err + integ + kd * deriv;
+
+    bool high = false, low = false;
+
+    s->saturated = false;
+    if(out > c->outMax)      { out = c->outMax; s->saturated = high = true; }
+    else if(out < c->outMin) { out = c->outMin; s->saturated = low  = true; }
+
+    s->rateLimited = false;
+    if(c->rateLimit > 0.) {
+        if(out > s->out + c->rateLimit)      { out = s->out + c->rateLimit; s->rateLimited = high = true; }
+        else if(out < s->out - c->rateLimit) { out = s->out - c->rateLimit; s->rateLimited = low  = true; }
+    }
+
+    // anti-windup: hold the integrator while the output is clamped and the error pushes further out
+    if(!((high && err > 0.) || (low && err < 0.))) s->integ = integ;
+
+    s->error = err;
+    s->out   = out;
+    s->word  = toWord(cavity, out);
+    s->steps++;
+
+    write(cavity, s->word);
+
+    return out;
+}
+
+void CpcavFeedback::getState(int cavity, pcavFbState *state)
+{
+    if(cavity < 0 || cavity >= PCAV_FB_NUM_CAVITY) return;
+
+    *state = state_[cavity];
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVFEEDBACK_H
+#define _PCAVFEEDBACK_H
+
+#include "pcavFw.h"
+
+#define PCAV_FB_NUM_CAVITY     2
+#define PCAV_FB_MAX_GAINSCHED  4
+
+typedef enum {
+    PCAV_FB_NCO = 0,           // correction in Hz, added to the NCO base frequency
+    PCAV_FB_PHASE_OFFSET       // correction in degree, added to the phase offset base of one probe
+} pcavFbActuator;
+
+// gain set which becomes active once |error| reaches absError (degree)
+struct pcavFbGain {
+    double    absError;
+    double    kp;
+    double    ki;
+    double    kd;
+};
+
+struct pcavFbConfig {
+    pcavFbActuator actuator;
+    int       probe;           // probe for PCAV_FB_PHASE_OFFSET
+    double    setpoint;        // phase setpoint, degree
+    double    kp;              // default gains, used below the first gain schedule entry
+    double    ki;              // per second
+    double    kd;              // seconds
+    double    dt;              // seconds per step, 1/pulse rate
+    double    ncoRefClock;     // NCO reference clock (Hz) for PCAV_FB_NCO, 0 for the nominal clock
+    double    outBase;         // NCO frequency (Hz) or phase offset (degree) the correction is added to
+    double    outMin;          // correction limits, the integrator does not wind up beyond them
+    double    outMax;
+    double    rateLimit;       // max change of the correction per step, 0 for no limit
+    int       nGainSched;      // entries in gainSched, sorted by ascending absError
+    pcavFbGain gainSched[PCAV_FB_MAX_GAINSCHED];
+};
+
+struct pcavFbState {
+    bool      enabled;
+    double    error;           // last phase error, degree
+    double    integ;           // integrator contribution to the correction
+    double    out;             // last correction
+    uint32_t  word;            // last register word written
+    bool      saturated;       // correction clamped by outMin/outMax
+    bool      rateLimited;
+    uint64_t  steps;
+};
+
+class CpcavFeedback {
+private:
+    pcavFw        fw_;
+    pcavFbConfig  cfg_[PCAV_FB_NUM_CAVITY];
+    pcavFbState   state_[PCAV_FB_NUM_CAVITY];
+    double        lastMeas_[PCAV_FB_NUM_CAVITY];
+
+    uint32_t  toWord(int cavity, double out);
+    void      write(int cavity, uint32_t word);
+
+public:
+    CpcavFeedback(pcavFw fw);
+
+    void  configure(int cavity, const pcavFbConfig &cfg);
+    void  enable(int cavity, bool enable);
+    void  reset(int cavity);    // clear integrator and history, correction restarts from 0
+
+    // one loop iteration, call right after the phase for this pulse has been read
+    // phase is the measured OutPhase or CompPhase in degree, returns the correction
+    double step(int cavity, double phase);
+
+    void  getState(int cavity, pcavFbState *state);
+};
+
+#endif /* _PCAVFEEDBACK_H */
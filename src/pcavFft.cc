@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavFft.h"
+
+#include <math.h>
+
+
+size_t CpcavFft::pow2(size_t n)
+{
+    size_t p = 1;
+
+    while(p < n) p <<= 1;
+
+    return p;
+}
+
+CpcavFft::CpcavFft(size_t n):
+    n_(pow2(n ? n : 1)),
+    log2n_(0)
+{
+    while(((size_t) 1 << log2n_) < n_) log2n_++;
+
+    rev_.resize(n_);
+    for(size_t i = 0; i < n_; i++) {
+        size_t r = 0;
+        for(int b = 0; b < log2n_; b++) if(i & ((size_t) 1 << b)) r |= (size_t) 1 << (log2n_ - 1 - b);
+        rev_[i] = r;
+    }
+
+    twiddle_.resize(n_);
+    for(size_t k = 0; k < n_ / 2; k++) {
+        twiddle_[2*k]     =  cos(2. * M_PI * k / n_);
+        twiddle_[2*k + 1] = -sin(2. * M_PI * k / n_);
+    }
+}
+
+void CpcavFft::forward(double *data)
+{
+    for(size_t i = 0; i < n_; i++) {
+        size_t r = rev_[i];
+        if(r > i) {
+            double t;
+            t = data[2*i];     data[2*i]     = data[2*r];     data[2*r]     = t;
+            t = data[2*i + 1]; data[2*i + 1] = data[2*r + 1]; data[2*r + 1] = t;
+        }
+    }
+
+    for(size_t len = 2; len <= n_; len <<= 1) {
+        size_t half = len / 2;
+        size_t step = n_ / len;
+        for(size_t s = 0; s < n_; s += len) {
+            for(size_t k = 0; k < half; k++) {
+                double wr = twiddle_[2 * k * step], wi = twiddle_[2 * k * step + 1];
+                double *a = data + 2 * (s + k);
+                double *b = data + 2 * (s + k + half);
+                double tr = b[0] * wr - b[1] * wi;
+                double ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;  b[1] = a[1] - ti;
+                a[0] += tr;        a[1] += ti;
+            }
+        }
+    }
+}
+
+void CpcavFft::inverse(double *data)
+{
+    // conj, forward, conj and scale
+    for(size_t i = 0; i < n_; i++) data[2*i + 1] = -data[2*i + 1];
+    forward(data);
+    double s = 1. / n_;
+    for(size_t i = 0; i < n_; i++) {
+        data[2*i]     *=  s;
+        data[2*i + 1] *= -s;
+    }
+}
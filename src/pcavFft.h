@@ -0,0 +1,36 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVFFT_H
+#define _PCAVFFT_H
+
+#include <stddef.h>
+#include <vector>
+
+// radix-2 complex FFT plan, bit reversal and twiddles computed once per size
+// data is interleaved re/im, transforms are in place and unnormalized
+class CpcavFft {
+private:
+    size_t    n_;
+    int       log2n_;
+    std::vector<size_t> rev_;
+    std::vector<double> twiddle_;    // n/2 pairs of cos, -sin
+
+public:
+    CpcavFft(size_t n);    // n is rounded up to a power of 2
+
+    size_t    size(void) const { return n_; }
+
+    void      forward(double *data);
+    void      inverse(double *data);    // scaled by 1/n
+
+    static size_t pow2(size_t n);
+};
+
+#endif /* _PCAVFFT_H */
@@ -8,6 +8,10 @@
 // the terms contained in the LICENSE.txt file.
 //////////////////////////////////////////////////////////////////////////////
 #include "pcavFw.h"
+#include "pcavNco.h"
+#include "pcavMetrics.h"
+#include "pcavBus.h"
+#include "pcavRegMap.h"
 
 #include <cpsw_yaml.h>
 #include <yaml-cpp/yaml.h>
@@ -18,46 +22,36 @@
 #include <sstream>
 
 #include <math.h>
+#include <string.h>
 
 
-#define CPSW_TRY_CATCH(X)       try {   \
-        (X);                            \
-    } catch (CPSWError &e) {            \
-        fprintf(stderr,                 \
-                "CPSW Error: %s at %s, line %d\n",     \
-                e.getInfo().c_str(),    \
-                __FILE__, __LINE__);    \
-        throw e;                        \
-    }
-
-
-#define _FIXED18_16_PHASE(P) \
-(((P) & 0x20000) ? ((double)(P) - (double)(0x40000)):(double)(P));
-
-#define _FIX_32_18(V) \
-(((V) & (1UL<<31))?((double)(V) - (double)(1UL<<32))/(double)(1<<18):(double)(V)/(double)(1<<18))
+inline static uint32_t nco(double v)
+{
+    return pcavNcoWord(v, PCAV_NCO_REF_CLOCK);
+}
 
-#define _FIX_18_18(V) \
-(((V) & 0x20000) ? ((double)(V) - (double)(0x40000))/(double)(0x40000):(double)(V)/(double)(0x40000))
+// nearest register word under the setter scaling v * scale, clamped to the field width, NaN writes 0
+static uint32_t setting_word(double v, double scale, unsigned bits, bool isSigned)
+{
+    double lo = isSigned ? -ldexp(1., bits - 1)     : 0.;
+    double hi = isSigned ?  ldexp(1., bits - 1) - 1. : ldexp(1., bits) - 1.;
+    double k  = v * scale;
 
-#define _FIX_18_17(V) \
-(((V) & 0x20000) ? ((double)(V) - (double)(0x40000))/(double)(0x20000):(double)(V)/(double)(0x20000))
+    if(isnan(k)) k = 0.;
+    if(k < lo)   k = lo;
+    if(k > hi)   k = hi;
 
-#define _FIX_18_16(V) \
-(((V) & 0x20000) ? ((double)(V) - (double)(0x40000))/(double)(0x10000):(double)(V)/(double)(0x10000))
+    return (uint32_t) (int32_t) lround(k);
+}
 
-#define _FIX_18_15(V) \
-(((V) & 0x20000) ? ((double)(V) - (double)(0x40000))/(double)(0x8000):(double)(V)/(double)(0x8000))
+// inverse of setting_word(), the word is taken at the field width
+static double setting_value(uint32_t word, double scale, unsigned bits, bool isSigned)
+{
+    uint64_t v = (uint64_t) word & (bits >= 32 ? 0xffffffffULL : ((1ULL << bits) - 1));
 
-#define _FIX_2_1(V) \
-(((V) & 0x2) ? ((double)(V) - (double)(0x4))/(double)(0x2):(double)(V)/(double)(0x2))
+    if(isSigned && (v & (1ULL << (bits - 1)))) return ((double) v - ldexp(1., bits)) / scale;
 
-inline static uint32_t nco(double v)
-{
-    int32_t out = (int32_t) ((v / 1.7E+7) * (double)((uint64_t)0x1<<32));
-    
-    return (uint32_t) (out >> 6);
-    
+    return (double) v / scale;
 }
 
 class CpcavFwAdapt;
@@ -71,11 +65,6 @@ protected:
 
     ScalVal_RO    version_;      // pcav firmware version
 
-    /* rf reference */
-    ScalVal_RO    rfRefAmpl_;    // RF reference amplitude,  fixed point 18.17
-    ScalVal_RO    rfRefPhase_;   // RF reference phase, fixed point 18.17
-    ScalVal_RO    rfRefI_;       // RF reference I, fixed point 18.17
-    ScalVal_RO    rfRefQ_;       // RF reference Q, fixed point 18.17
     ScalVal       rfRefSel_;     // RF reference selection, unsigned fixed 4.0
 
     ScalVal       wfDataSel_[8];    // wfDataSelector
@@ -84,112 +73,69 @@ protected:
     /* cavity 1 */
     /* probe 1 */
 
-    ScalVal_RO    cav1P1IfAmpl_;    // IF amplitude for cavity 1 probe 1, fixed 18.17
-    ScalVal_RO    cav1P1IfPhase_;   // IF phase for cavity 1 probe 1, fixed 18.17
-    ScalVal_RO    cav1P1IfI_;       // IF I for cavity 1 probe 1, fixed 18.17
-    ScalVal_RO    cav1P1IfQ_;       // IF Q for cavity 1 probe 1, fixed 18.17
     ScalVal       cav1P1ChanSel_;   // Channel Select for cavity 1 probe 1, unsigned fixed 4.0
-    ScalVal_RO    cav1P1DCReal_;    // DC real part for cavity 1, probe 1, fixed 21.19
-    ScalVal_RO    cav1P1DCImage_;   // DC imaginary part for cavity 1, probe 1, fixed 21.19
     ScalVal       cav1P1WindowStart_;    // Integration window start for cavity 1, probe 1, unsigned fixed 16.0
     ScalVal       cav1P1WindowStop_;     // Integration window stop for cavity 1, probe 1,  unsigned fixed 16.0
-    ScalVal_RO    cav1P1DCFreq_;    // DC frequency for cavity 1, probe 1, fixed 26.0
-    ScalVal_RO    cav1P1IntegI_;    // Integrated I for cavity 1, probe 1, fixed 18.17
-    ScalVal_RO    cav1P1IntegQ_;    // Integrated Q for cavity 1, probe 1, fixed 18.17
-    ScalVal_RO    cav1P1OutPhase_;     // Output Phase for cavity 1, probe 1, fixed 18.17
-    ScalVal_RO    cav1P1OutAmpl_;      // Output amplitude for cavity 1, probe 1, fixed 18.17
-
-    ScalVal_RO    cav1P1CompPhase_;     // Comparison phase for cavity 1, probe 1, fixed 18.17
 
     ScalVal       cav1P1CalibCoeff_;    // calibration coefficient (TBD)
-    ScalVal       cav1P1PhaseOffset_;   // Phase Offset (TBD)
-    ScalVal       cav1P1Weight_;        // Weights (TBD)
     // NCO
     ScalVal       cav1NCOPhaseAdj_;    // NCO phase adjust for cavity 1, unsigned fixed 29.29
 
     /* probe 2 */
 
-    ScalVal_RO    cav1P2IfAmpl_;    // IF amplitude for cavity 1 probe 2, fixed 18.17
-    ScalVal_RO    cav1P2IfPhase_;   // IF phase for cavity 1 probe 2, fixed 18.17
-    ScalVal_RO    cav1P2IfI_;       // IF I for cavity 1 probe 2, fixed 18.17
-    ScalVal_RO    cav1P2IfQ_;       // IF Q for cavity 1 probe 2, fixed 18.17
     ScalVal       cav1P2ChanSel_;   // Channel Select for cavity 1 probe 2, unsigned fixed 4.0
-    ScalVal_RO    cav1P2DCReal_;    // DC real part for cavity 1, probe 2, fixed 21.19
-    ScalVal_RO    cav1P2DCImage_;   // DC imaginary part for cavity 1, probe 2, fixed 21.19
     ScalVal       cav1P2WindowStart_;    // Integration window start for cavity 1, probe 2, unsigned fixed 16.0
     ScalVal       cav1P2WindowStop_;     // Integration window stop for cavity 1, probe 2,  unsigned fixed 16.0
-    ScalVal_RO    cav1P2DCFreq_;    // DC frequency for cavity 1, probe 2, fixed 26.0
-    ScalVal_RO    cav1P2IntegI_;    // Integrated I for cavity 1, probe 2, fixed 18.17
-    ScalVal_RO    cav1P2IntegQ_;    // Integrated Q for cavity 1, probe 2, fixed 18.17
-    ScalVal_RO    cav1P2OutPhase_;     // Output Phase for cavity 1, probe 2, fixed 18.17
-    ScalVal_RO    cav1P2OutAmpl_;      // Output amplitude for cavity 1, probe 2, fixed 18.17
 
     ScalVal       cav1FreqEvalStart_;
     ScalVal       cav1FreqEvalStop_;
 
-    ScalVal_RO    cav1P2CompPhase_;     // Comparison phase for cavity 1, probe 2, fixed 18.17
-
     ScalVal       cav1RegLatchPt_;
 
     ScalVal       cav1P2CalibCoeff_;    // calibration coefficient (TBD)
-    ScalVal       cav1P2PhaseOffset_;   // Phase Offset (TBD)
-    ScalVal       cav1P2Weight_;        // Weights (TBD)
 
     /* cavity 2 */
     /* probe 1 */
 
-    ScalVal_RO    cav2P1IfAmpl_;    // IF amplitude for cavity 2 probe 1, fixed 18.17
-    ScalVal_RO    cav2P1IfPhase_;   // IF phase for cavity 2 probe 1, fixed 18.17
-    ScalVal_RO    cav2P1IfI_;       // IF I for cavity 2 probe 1, fixed 18.17
-    ScalVal_RO    cav2P1IfQ_;       // IF Q for cavity 2 probe 1, fixed 18.17
     ScalVal       cav2P1ChanSel_;   // Channel Select for cavity 2 probe 1, unsigned fixed 4.0
-    ScalVal_RO    cav2P1DCReal_;    // DC real part for cavity 2, probe 1, fixed 21.19
-    ScalVal_RO    cav2P1DCImage_;   // DC imaginary part for cavity 2, probe 1, fixed 21.19
     ScalVal       cav2P1WindowStart_;    // Integration window start for cavity 2, probe 1, unsigned fixed 16.0
     ScalVal       cav2P1WindowStop_;     // Integration window stop for cavity 2, probe 1,  unsigned fixed 16.0
-    ScalVal_RO    cav2P1DCFreq_;    // DC frequency for cavity 2, probe 1, fixed 26.0
-    ScalVal_RO    cav2P1IntegI_;    // Integrated I for cavity 2, probe 1, fixed 18.17
-    ScalVal_RO    cav2P1IntegQ_;    // Integrated Q for cavity 2, probe 1, fixed 18.17
-    ScalVal_RO    cav2P1OutPhase_;     // Output Phase for cavity 2, probe 1, fixed 18.17
-    ScalVal_RO    cav2P1OutAmpl_;      // Output amplitude for cavity 2, probe 1, fixed 18.17
-
-    ScalVal_RO    cav2P1CompPhase_;     // Comparison phase for cavity 1, probe 1, fixed 18.17
 
     ScalVal       cav2P1CalibCoeff_;    // calibration coefficient (TBD)
-    ScalVal       cav2P1PhaseOffset_;   // Phase Offset (TBD)
-    ScalVal       cav2P1Weight_;        // Weights (TBD)
     // NCO
     ScalVal       cav2NCOPhaseAdj_;    // NCO phase adjust for cavity 2, unsigned fixed 29.29
 
     /* probe 2 */
 
-    ScalVal_RO    cav2P2IfAmpl_;    // IF amplitude for cavity 2 probe 2, fixed 18.17
-    ScalVal_RO    cav2P2IfPhase_;   // IF phase for cavity 2 probe 2, fixed 18.17
-    ScalVal_RO    cav2P2IfI_;       // IF I for cavity 2 probe 2, fixed 18.17
-    ScalVal_RO    cav2P2IfQ_;       // IF Q for cavity 2 probe 2, fixed 18.17
     ScalVal       cav2P2ChanSel_;   // Channel Select for cavity 2 probe 2, unsigned fixed 4.0
-    ScalVal_RO    cav2P2DCReal_;    // DC real part for cavity 2, probe 2, fixed 21.19
-    ScalVal_RO    cav2P2DCImage_;   // DC imaginary part for cavity 2, probe 2, fixed 21.19
     ScalVal       cav2P2WindowStart_;    // Integration window start for cavity 2, probe 2, unsigned fixed 16.0
     ScalVal       cav2P2WindowStop_;     // Integration window stop for cavity 2, probe 2,  unsigned fixed 16.0
-    ScalVal_RO    cav2P2DCFreq_;    // DC frequency for cavity 2, probe 2, fixed 26.0
-    ScalVal_RO    cav2P2IntegI_;    // Integrated I for cavity 2, probe 2, fixed 18.17
-    ScalVal_RO    cav2P2IntegQ_;    // Integrated Q for cavity 2, probe 2, fixed 18.17
-    ScalVal_RO    cav2P2OutPhase_;     // Output Phase for cavity 2, probe 2, fixed 18.17
-    ScalVal_RO    cav2P2OutAmpl_;      // Output amplitude for cavity 2, probe 2, fixed 18.17
 
     ScalVal       cav2FreqEvalStart_;
     ScalVal       cav2FreqEvalStop_;
 
-    ScalVal_RO    cav2P2CompPhase_;     // Comparison phase for cavity 2, probe 2, fixed 18.17
-
     ScalVal       cav2RegLatchPt_;
 
     ScalVal       cav2P2CalibCoeff_;    // calibration coefficient (TBD)
-    ScalVal       cav2P2PhaseOffset_;   // Phase Offset (TBD)
-    ScalVal       cav2P2Weight_;        // Weights (TBD)
 
+    /* registers built from the pcavRegMap.h descriptor tables, same indices */
+    ScalVal_RO    refReg_[PCAV_NUM_REF_FIELDS];
+    ScalVal_RO    probeReg_[PCAV_NUM_CAVITY][PCAV_NUM_PROBE][PCAV_NUM_PROBE_FIELDS];
+    ScalVal       settingReg_[PCAV_NUM_CAVITY][PCAV_NUM_PROBE][PCAV_NUM_SETTINGS];
+    uint64_t      pulseId_;
+
+    ScalVal_RO    latchCnt_;        // optional latch counter, the pulse ID source when configured
+    uint64_t      latchId_;         // latch count extended to 64 bit
+    bool          latchPrimed_;
+    uint32_t      latchFlags_;      // PCAV_SNAP_HW_ID if the counter holds the timing system pulse ID
+    pcavCoherentStats coherentStats_;
 
+    void  readSnapshot(pcavSnapshot *snap);
+    uint64_t latchId(uint32_t count);
+
+    template <int FIELD> double probeField(int cavity, int probe, int32_t *raw);
+    template <typename F> double settingField(int cavity, int probe, int setting, int32_t *raw);
+    void  setSettingRaw(int cavity, int probe, int setting, uint32_t word);
 
 public:
     CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie);
@@ -213,6 +159,10 @@ public:
     virtual uint32_t setCalibCoeff(int cavity, int probe, double v);
     virtual uint32_t setPhaseOffset(int cavity, int probe, double v);
     virtual uint32_t setWeight(int cavity, int probe, double v);
+    virtual void setNCORaw(int cavity, uint32_t word);
+    virtual void setPhaseOffsetRaw(int cavity, int probe, uint32_t word);
+    virtual void setCalibCoeffRaw(int cavity, int probe, uint32_t word);
+    virtual void setWeightRaw(int cavity, int probe, uint32_t word);
 
     /* monitor for reference */
     virtual double getRefAmpl(int32_t *raw);
@@ -235,6 +185,15 @@ public:
     virtual double getCompPhase(int cavity, int probe, int32_t *raw);
     virtual double getPhaseOffset(int cavity, int probe, int32_t *raw);
     virtual double getWeight(int cavity, int probe, int32_t *raw);
+
+    /* bulk monitor */
+    virtual double getProbeField(int cavity, int probe, pcavProbeField field, int32_t *raw);
+    virtual double getRefField(pcavRefField field, int32_t *raw);
+    virtual void getSnapshot(pcavSnapshot *snap);
+    virtual bool getSnapshotCoherent(pcavSnapshot *snap, int maxRetry);
+    virtual void setLatchCounter(const char *name, bool timingId);
+    virtual void getCoherentStats(pcavCoherentStats *stats);
+    virtual void clearCoherentStats(void);
 };
 
 
@@ -243,6 +202,74 @@ pcavFw IpcavFw::create(Path p)
     return IEntryAdapt::check_interface<pcavFwAdapt, DevImpl> (p);
 }
 
+uint32_t IpcavFw::ncoWord(double v)
+{
+    return nco(v);
+}
+
+uint32_t IpcavFw::phaseOffsetWord(double v)
+{
+    typedef pcavPhaseOffsetFmt F;
+
+    return setting_word(v, (1 << F::frac) - 1, F::bits, F::isSigned);
+}
+
+uint32_t IpcavFw::calibCoeffWord(double v)
+{
+    return setting_word(v, (1<<17)-1, 18, true);
+}
+
+uint32_t IpcavFw::weightWord(double v)
+{
+    typedef pcavWeightFmt F;
+
+    return setting_word(v, 1 << F::frac, F::bits, F::isSigned);    // 0, 0.5, 1 or 1.5 for 2.1
+}
+
+double IpcavFw::phaseOffsetValue(uint32_t word)
+{
+    typedef pcavPhaseOffsetFmt F;
+
+    return setting_value(word, (1 << F::frac) - 1, F::bits, F::isSigned);
+}
+
+double IpcavFw::calibCoeffValue(uint32_t word)
+{
+    return setting_value(word, (1<<17)-1, 18, true);
+}
+
+double IpcavFw::convert(pcavProbeField field, int32_t raw)
+{
+    switch(field) {
+        case PCAV_IF_AMPL:    return pcavProbeConv<PCAV_IF_AMPL>(raw);
+        case PCAV_IF_PHASE:   return pcavProbeConv<PCAV_IF_PHASE>(raw);
+        case PCAV_IF_I:       return pcavProbeConv<PCAV_IF_I>(raw);
+        case PCAV_IF_Q:       return pcavProbeConv<PCAV_IF_Q>(raw);
+        case PCAV_DC_REAL:    return pcavProbeConv<PCAV_DC_REAL>(raw);
+        case PCAV_DC_IMAGE:   return pcavProbeConv<PCAV_DC_IMAGE>(raw);
+        case PCAV_DC_FREQ:    return pcavProbeConv<PCAV_DC_FREQ>(raw);
+        case PCAV_INTEG_I:    return pcavProbeConv<PCAV_INTEG_I>(raw);
+        case PCAV_INTEG_Q:    return pcavProbeConv<PCAV_INTEG_Q>(raw);
+        case PCAV_OUT_PHASE:  return pcavProbeConv<PCAV_OUT_PHASE>(raw);
+        case PCAV_OUT_AMPL:   return pcavProbeConv<PCAV_OUT_AMPL>(raw);
+        case PCAV_COMP_PHASE: return pcavProbeConv<PCAV_COMP_PHASE>(raw);
+        default:
+            return 0.;
+    }
+}
+
+double IpcavFw::convert(pcavRefField field, int32_t raw)
+{
+    switch(field) {
+        case PCAV_REF_AMPL:   return pcavRefConv<PCAV_REF_AMPL>(raw);
+        case PCAV_REF_PHASE:  return pcavRefConv<PCAV_REF_PHASE>(raw);
+        case PCAV_REF_I:      return pcavRefConv<PCAV_REF_I>(raw);
+        case PCAV_REF_Q:      return pcavRefConv<PCAV_REF_Q>(raw);
+        default:
+            return 0.;
+    }
+}
+
 CpcavFwAdapt::CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie):
     IEntryAdapt(k, p, ie),
     pPcavReg_(p->findByName("AppTop/AppCore/Sysgen/PcavReg")),
@@ -250,37 +277,16 @@ CpcavFwAdapt::CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie)
 
     version_(        IScalVal_RO::create(pPcavReg_->findByName("version"))),
 
-    /* rf reference */
-    rfRefAmpl_(      IScalVal_RO::create(pPcavReg_->findByName("rfRefAmpl"))),
-    rfRefPhase_(     IScalVal_RO::create(pPcavReg_->findByName("rfRefPhase"))),
-    rfRefI_(         IScalVal_RO::create(pPcavReg_->findByName("rfRefI"))),
-    rfRefQ_(         IScalVal_RO::create(pPcavReg_->findByName("rfRefQ"))),
     rfRefSel_(       IScalVal   ::create(pPcavReg_->findByName("rfRefSel"))),
 
-
     /* cavity 1 */
     /* probe 1 */
 
-    cav1P1IfAmpl_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P1IfAmpl"))),
-    cav1P1IfPhase_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P1IfPhase"))),
-    cav1P1IfI_(         IScalVal_RO::create(pPcavReg_->findByName("cav1P1IfI"))),
-    cav1P1IfQ_(         IScalVal_RO::create(pPcavReg_->findByName("cav1P1IfQ"))),
     cav1P1ChanSel_(     IScalVal   ::create(pPcavReg_->findByName("cav1P1ChanSel"))),
-    cav1P1DCReal_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P1DCReal"))),
-    cav1P1DCImage_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P1DCImage"))),
     cav1P1WindowStart_( IScalVal   ::create(pPcavReg_->findByName("cav1P1WindowStart"))),
     cav1P1WindowStop_(  IScalVal   ::create(pPcavReg_->findByName("cav1P1WindowStop"))),
-    cav1P1DCFreq_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P1DCFreq"))),
-    cav1P1IntegI_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P1IntegI"))),
-    cav1P1IntegQ_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P1IntegQ"))),
-    cav1P1OutPhase_(    IScalVal_RO::create(pPcavReg_->findByName("cav1P1OutPhase"))),
-    cav1P1OutAmpl_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P1OutAmpl"))),
-
-    cav1P1CompPhase_(   IScalVal_RO::create(pPcavReg_->findByName("cav1P1CompPhase"))),
 
     cav1P1CalibCoeff_(  IScalVal::create(pPcavReg_->findByName("cav1P1CalibCoeff"))),
-    cav1P1PhaseOffset_( IScalVal::create(pDiagBus_->findByName("Cavity0Probe0PhaseOffset"))),
-    cav1P1Weight_(      IScalVal::create(pDiagBus_->findByName("Cavity0Probe0Weight"))),
 
     /* NCO for cavity 1 */
 
@@ -288,56 +294,25 @@ CpcavFwAdapt::CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie)
 
     /* probe 2 */
 
-    cav1P2IfAmpl_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P2IfAmpl"))),
-    cav1P2IfPhase_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P2IfPhase"))),
-    cav1P2IfI_(         IScalVal_RO::create(pPcavReg_->findByName("cav1P2IfI"))),
-    cav1P2IfQ_(         IScalVal_RO::create(pPcavReg_->findByName("cav1P2IfQ"))),
     cav1P2ChanSel_(     IScalVal   ::create(pPcavReg_->findByName("cav1P2ChanSel"))),
-    cav1P2DCReal_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P2DCReal"))),
-    cav1P2DCImage_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P2DCImage"))),
     cav1P2WindowStart_( IScalVal   ::create(pPcavReg_->findByName("cav1P2WindowStart"))),
     cav1P2WindowStop_(  IScalVal   ::create(pPcavReg_->findByName("cav1P2WindowStop"))),
-    cav1P2DCFreq_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P2DCFreq"))),
-    cav1P2IntegI_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P2IntegI"))),
-    cav1P2IntegQ_(      IScalVal_RO::create(pPcavReg_->findByName("cav1P2IntegQ"))),
-    cav1P2OutPhase_(    IScalVal_RO::create(pPcavReg_->findByName("cav1P2OutPhase"))),
-    cav1P2OutAmpl_(     IScalVal_RO::create(pPcavReg_->findByName("cav1P2OutAmpl"))),
 
     cav1FreqEvalStart_( IScalVal   ::create(pPcavReg_->findByName("cav1FreqEvalStart"))),
     cav1FreqEvalStop_(  IScalVal   ::create(pPcavReg_->findByName("cav1FreqEvalStop"))),
 
-    cav1P2CompPhase_(   IScalVal_RO::create(pPcavReg_->findByName("cav1P2CompPhase"))),
-
     cav1RegLatchPt_(    IScalVal   ::create(pPcavReg_->findByName("cav1RegLatchPt"))),
 
     cav1P2CalibCoeff_(  IScalVal::create(pPcavReg_->findByName("cav1P2CalibCoeff"))),
-    cav1P2PhaseOffset_( IScalVal::create(pDiagBus_->findByName("Cavity0Probe1PhaseOffset"))),
-    cav1P2Weight_(      IScalVal::create(pDiagBus_->findByName("Cavity0Probe1Weight"))),
-
 
     /* cavity 2 */
     /* probe 1 */
 
-    cav2P1IfAmpl_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P1IfAmpl"))),
-    cav2P1IfPhase_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P1IfPhase"))),
-    cav2P1IfI_(         IScalVal_RO::create(pPcavReg_->findByName("cav2P1IfI"))),
-    cav2P1IfQ_(         IScalVal_RO::create(pPcavReg_->findByName("cav2P1IfQ"))),
     cav2P1ChanSel_(     IScalVal   ::create(pPcavReg_->findByName("cav2P1ChanSel"))),
-    cav2P1DCReal_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P1DCReal"))),
-    cav2P1DCImage_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P1DCImage"))),
     cav2P1WindowStart_( IScalVal   ::create(pPcavReg_->findByName("cav2P1WindowStart"))),
     cav2P1WindowStop_(  IScalVal   ::create(pPcavReg_->findByName("cav2P1WindowStop"))),
-    cav2P1DCFreq_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P1DCFreq"))),
-    cav2P1IntegI_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P1IntegI"))),
-    cav2P1IntegQ_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P1IntegQ"))),
-    cav2P1OutPhase_(    IScalVal_RO::create(pPcavReg_->findByName("cav2P1OutPhase"))),
-    cav2P1OutAmpl_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P1OutAmpl"))),
-
-    cav2P1CompPhase_(   IScalVal_RO::create(pPcavReg_->findByName("cav2P1CompPhase"))),
 
     cav2P1CalibCoeff_(  IScalVal   ::create(pPcavReg_->findByName("cav2P1CalibCoeff"))),
-    cav2P1PhaseOffset_( IScalVal::create(pDiagBus_->findByName("Cavity1Probe0PhaseOffset"))),
-    cav2P1Weight_(      IScalVal::create(pDiagBus_->findByName("Cavity1Probe0Weight"))),
 
     /* NCO for cavity 2 */
 
@@ -345,31 +320,16 @@ CpcavFwAdapt::CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie)
 
     /* probe 2 */
 
-    cav2P2IfAmpl_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P2IfAmpl"))),
-    cav2P2IfPhase_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P2IfPhase"))),
-    cav2P2IfI_(         IScalVal_RO::create(pPcavReg_->findByName("cav2P2IfI"))),
-    cav2P2IfQ_(         IScalVal_RO::create(pPcavReg_->findByName("cav2P2IfQ"))),
     cav2P2ChanSel_(     IScalVal   ::create(pPcavReg_->findByName("cav2P2ChanSel"))),
-    cav2P2DCReal_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P2DCReal"))),
-    cav2P2DCImage_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P2DCImage"))),
     cav2P2WindowStart_( IScalVal   ::create(pPcavReg_->findByName("cav2P2WindowStart"))),
     cav2P2WindowStop_(  IScalVal   ::create(pPcavReg_->findByName("cav2P2WindowStop"))),
-    cav2P2DCFreq_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P2DCFreq"))),
-    cav2P2IntegI_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P2IntegI"))),
-    cav2P2IntegQ_(      IScalVal_RO::create(pPcavReg_->findByName("cav2P2IntegQ"))),
-    cav2P2OutPhase_(    IScalVal_RO::create(pPcavReg_->findByName("cav2P2OutPhase"))),
-    cav2P2OutAmpl_(     IScalVal_RO::create(pPcavReg_->findByName("cav2P2OutAmpl"))),
 
     cav2FreqEvalStart_( IScalVal   ::create(pPcavReg_->findByName("cav2FreqEvalStart"))),
     cav2FreqEvalStop_(  IScalVal   ::create(pPcavReg_->findByName("cav2FreqEvalStop"))),
 
-    cav2P2CompPhase_(   IScalVal_RO::create(pPcavReg_->findByName("cav2P2CompPhase"))),
-
     cav2RegLatchPt_(    IScalVal   ::create(pPcavReg_->findByName("cav2RegLatchPt"))),
 
-    cav2P2CalibCoeff_(  IScalVal::create(pPcavReg_->findByName("cav2P2CalibCoeff"))),
-    cav2P2PhaseOffset_( IScalVal::create(pDiagBus_->findByName("Cavity1Probe1PhaseOffset"))),
-    cav2P2Weight_(      IScalVal::create(pDiagBus_->findByName("Cavity1Probe1Weight")))
+    cav2P2CalibCoeff_(  IScalVal::create(pPcavReg_->findByName("cav2P2CalibCoeff")))
 
 {
     char name[80];
@@ -378,11 +338,68 @@ CpcavFwAdapt::CpcavFwAdapt(Key &k, ConstPath p, shared_ptr<const CEntryImpl> ie)
          sprintf(name, "wfData%dSel", i);
          wfDataSel_[i] = IScalVal::create(pPcavReg_->findByName(name));
      }
+
+    for(int f = 0; f < PCAV_NUM_REF_FIELDS; f++)
+        refReg_[f] = IScalVal_RO::create(pPcavReg_->findByName(pcavRefRegDesc[f].name));
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            for(int f = 0; f < PCAV_NUM_PROBE_FIELDS; f++)
+                probeReg_[c][p][f] = IScalVal_RO::create(pPcavReg_->findByName(pcavProbeRegDesc[c][p][f].name));
+            for(int k = 0; k < PCAV_NUM_SETTINGS; k++)
+                settingReg_[c][p][k] = IScalVal::create(pDiagBus_->findByName(pcavSettingRegDesc[c][p][k].name));
+        }
+    }
+
+    pulseId_     = 0;
+    latchId_     = 0;
+    latchPrimed_ = false;
+    latchFlags_  = 0;
+    memset(&coherentStats_, 0, sizeof(coherentStats_));
+}
+
+inline static bool valid_probe(int cavity, int probe)
+{
+    return cavity >= 0 && cavity < PCAV_NUM_CAVITY && probe >= 0 && probe < PCAV_NUM_PROBE;
+}
+
+// out of range reads return 0 with raw 0, out of range writes are ignored
+template <int FIELD>
+double CpcavFwAdapt::probeField(int cavity, int probe, int32_t *raw)
+{
+    if(!valid_probe(cavity, probe)) {
+        *raw = 0;
+        return 0.;
+    }
+
+    CPSW_TRY_CATCH(probeReg_[cavity][probe][FIELD], getVal((uint32_t*) raw));
+
+    return pcavProbeConv<FIELD>(*raw);
+}
+
+template <typename F>
+double CpcavFwAdapt::settingField(int cavity, int probe, int setting, int32_t *raw)
+{
+    if(!valid_probe(cavity, probe)) {
+        *raw = 0;
+        return 0.;
+    }
+
+    CPSW_TRY_CATCH(settingReg_[cavity][probe][setting], getVal((uint32_t*) raw));
+
+    return pcavSettingConv<F>(*raw);
+}
+
+void CpcavFwAdapt::setSettingRaw(int cavity, int probe, int setting, uint32_t word)
+{
+    if(!valid_probe(cavity, probe)) return;
+
+    CPSW_TRY_CATCH(settingReg_[cavity][probe][setting], setVal(word));
 }
 
 void CpcavFwAdapt::getVersion(int32_t *version)
 {
-    CPSW_TRY_CATCH(version_->getVal((uint32_t*) version));
+    CPSW_TRY_CATCH(version_, getVal((uint32_t*) version));
 }
 
 //
@@ -393,7 +410,7 @@ void CpcavFwAdapt::getVersion(int32_t *version)
 
 void CpcavFwAdapt::setRefSel(uint32_t channel)
 {
-    CPSW_TRY_CATCH(rfRefSel_->setVal(channel));
+    CPSW_TRY_CATCH(rfRefSel_, setVal(channel));
 }
 
 //
@@ -404,7 +421,7 @@ void CpcavFwAdapt::setRefSel(uint32_t channel)
 
 void CpcavFwAdapt::setWfDataSel(int index, uint32_t sel)
 {
-    CPSW_TRY_CATCH(wfDataSel_[index]->setVal(sel));
+    CPSW_TRY_CATCH(wfDataSel_[index], setVal(sel));
 }
 
 //
@@ -417,16 +434,21 @@ uint32_t CpcavFwAdapt::setNCO(int cavity, double v)
 {
     uint32_t  out = nco(v);
 
+    setNCORaw(cavity, out);
+
+    return out;
+}
+
+void CpcavFwAdapt::setNCORaw(int cavity, uint32_t word)
+{
     switch(cavity) {
         case 0:    // cavity 0
-            CPSW_TRY_CATCH(cav1NCOPhaseAdj_->setVal(out));
+            CPSW_TRY_CATCH(cav1NCOPhaseAdj_, setVal(word));
             break;
         case 1:    // cavity 1
-            CPSW_TRY_CATCH(cav2NCOPhaseAdj_->setVal(out));
+            CPSW_TRY_CATCH(cav2NCOPhaseAdj_, setVal(word));
             break;
     }
-
-    return out;
 }
 
 
@@ -436,20 +458,20 @@ void CpcavFwAdapt::setChanSel(int cavity, int probe, uint32_t channel)
         case 0:
             switch(probe) {
                 case 0:         // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1ChanSel_->setVal(channel));
+                    CPSW_TRY_CATCH(cav1P1ChanSel_, setVal(channel));
                     break;
                 case 1:         // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2ChanSel_->setVal(channel));
+                    CPSW_TRY_CATCH(cav1P2ChanSel_, setVal(channel));
                     break;
             }
             break;
         case 1:
             switch(probe) {
                 case 0:         // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1ChanSel_->setVal(channel));
+                    CPSW_TRY_CATCH(cav2P1ChanSel_, setVal(channel));
                     break;
                 case 1:         // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2ChanSel_->setVal(channel));
+                    CPSW_TRY_CATCH(cav2P2ChanSel_, setVal(channel));
                     break;
             }
             break;
@@ -462,20 +484,20 @@ void CpcavFwAdapt::setWindowStart(int cavity, int probe, uint32_t start)
         case 0:
             switch(probe) {
                 case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1WindowStart_->setVal(start));
+                    CPSW_TRY_CATCH(cav1P1WindowStart_, setVal(start));
                     break;
                 case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2WindowStart_->setVal(start));
+                    CPSW_TRY_CATCH(cav1P2WindowStart_, setVal(start));
                     break;
             }
             break;
         case 1:
             switch(probe) {
                 case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1WindowStart_->setVal(start));
+                    CPSW_TRY_CATCH(cav2P1WindowStart_, setVal(start));
                     break;
                 case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2WindowStart_->setVal(start));
+                    CPSW_TRY_CATCH(cav2P2WindowStart_, setVal(start));
                     break;
             }
             break;
@@ -489,20 +511,20 @@ void CpcavFwAdapt::setWindowEnd(int cavity, int probe, uint32_t end)
         case 0:
             switch(probe) {
                 case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1WindowStop_->setVal(end));
+                    CPSW_TRY_CATCH(cav1P1WindowStop_, setVal(end));
                     break;
                 case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2WindowStop_->setVal(end));
+                    CPSW_TRY_CATCH(cav1P2WindowStop_, setVal(end));
                     break;
             }
             break;
         case 1:
             switch(probe) {
                 case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1WindowStop_->setVal(end));
+                    CPSW_TRY_CATCH(cav2P1WindowStop_, setVal(end));
                     break;
                 case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2WindowStop_->setVal(end));
+                    CPSW_TRY_CATCH(cav2P2WindowStop_, setVal(end));
                     break;
             }
             break;
@@ -513,10 +535,10 @@ void CpcavFwAdapt::setFreqEvalStart(int cavity, uint32_t start)
 {
     switch(cavity) {
         case 0:  // cavity 0
-            CPSW_TRY_CATCH(cav1FreqEvalStart_->setVal(start));
+            CPSW_TRY_CATCH(cav1FreqEvalStart_, setVal(start));
             break;
         case 1:  // cavity 1
-            CPSW_TRY_CATCH(cav2FreqEvalStart_->setVal(start));
+            CPSW_TRY_CATCH(cav2FreqEvalStart_, setVal(start));
             break;
     }
 }
@@ -525,10 +547,10 @@ void CpcavFwAdapt::setFreqEvalEnd(int cavity, uint32_t end)
 {
     switch(cavity) {
         case 0:    // cavity 0
-            CPSW_TRY_CATCH(cav1FreqEvalStop_->setVal(end));
+            CPSW_TRY_CATCH(cav1FreqEvalStop_, setVal(end));
             break;
         case 1:    // cavity 1
-            CPSW_TRY_CATCH(cav2FreqEvalStop_->setVal(end));
+            CPSW_TRY_CATCH(cav2FreqEvalStop_, setVal(end));
             break;
     }
 }
@@ -537,102 +559,77 @@ void CpcavFwAdapt::setRegLatchPoint(int cavity, uint32_t point)
 {
     switch(cavity) {
         case 0:    // cavity 0
-            CPSW_TRY_CATCH(cav1RegLatchPt_->setVal(point));
+            CPSW_TRY_CATCH(cav1RegLatchPt_, setVal(point));
             break;
         case 1:    // cavity 1
-            CPSW_TRY_CATCH(cav2RegLatchPt_->setVal(point));
+            CPSW_TRY_CATCH(cav2RegLatchPt_, setVal(point));
             break;
     }
 }
 
 uint32_t CpcavFwAdapt::setCalibCoeff(int cavity, int probe, double v)
 {
-    uint32_t out = (v * ((1<< 17)-1));
+    uint32_t out = calibCoeffWord(v);
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1CalibCoeff_->setVal(out));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2CalibCoeff_->setVal(out));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1CalibCoeff_->setVal(out));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2CalibCoeff_->setVal(out));
-                    break;
-            }
-            break;
-    }
+    setCalibCoeffRaw(cavity, probe, out);
 
     return out;
 }
 
-uint32_t CpcavFwAdapt::setPhaseOffset(int cavity, int probe, double v)
+void CpcavFwAdapt::setCalibCoeffRaw(int cavity, int probe, uint32_t word)
 {
-    uint32_t out = (v * ((1<<15)-1));
-
     switch(cavity) {
         case 0:
             switch(probe) {
                 case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1PhaseOffset_->setVal(out));
+                    CPSW_TRY_CATCH(cav1P1CalibCoeff_, setVal(word));
                     break;
                 case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2PhaseOffset_->setVal(out));
+                    CPSW_TRY_CATCH(cav1P2CalibCoeff_, setVal(word));
                     break;
             }
             break;
         case 1:
             switch(probe) {
                 case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1PhaseOffset_->setVal(out));
+                    CPSW_TRY_CATCH(cav2P1CalibCoeff_, setVal(word));
                     break;
                 case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2PhaseOffset_->setVal(out));
+                    CPSW_TRY_CATCH(cav2P2CalibCoeff_, setVal(word));
                     break;
             }
             break;
     }
+}
+
+uint32_t CpcavFwAdapt::setPhaseOffset(int cavity, int probe, double v)
+{
+    uint32_t out = phaseOffsetWord(v);
+
+    setPhaseOffsetRaw(cavity, probe, out);
+
     return out;
 }
 
+void CpcavFwAdapt::setPhaseOffsetRaw(int cavity, int probe, uint32_t word)
+{
+    setSettingRaw(cavity, probe, PCAV_SETTING_PHASE_OFFSET, word);
+}
+
 uint32_t CpcavFwAdapt::setWeight(int cavity, int probe, double v)
 {
-    uint32_t out = (v * (1<<1));
+    uint32_t out = weightWord(v);
+
+    setWeightRaw(cavity, probe, out);
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1Weight_->setVal(out));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2Weight_->setVal(out));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1Weight_->setVal(out));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2Weight_->setVal(out));
-                    break;
-            }
-            break;
-    }
     return out;
 }
 
+void CpcavFwAdapt::setWeightRaw(int cavity, int probe, uint32_t word)
+{
+    setSettingRaw(cavity, probe, PCAV_SETTING_WEIGHT, word);
+}
+
 //
 //
 /* monitor for reference */
@@ -643,9 +640,9 @@ double CpcavFwAdapt::getRefAmpl(int32_t *raw)
 {
     double v;
 
-    CPSW_TRY_CATCH(rfRefAmpl_->getVal((uint32_t*) raw));
+    CPSW_TRY_CATCH(refReg_[PCAV_REF_AMPL], getVal((uint32_t*) raw));
 
-    v = _FIX_18_17(*raw);
+    v = pcavRefConv<PCAV_REF_AMPL>(*raw);
 
     return v;
 }
@@ -654,9 +651,9 @@ double CpcavFwAdapt::getRefPhase(int32_t *raw)
 {
     double v;
 
-    CPSW_TRY_CATCH(rfRefPhase_->getVal((uint32_t*) raw));
+    CPSW_TRY_CATCH(refReg_[PCAV_REF_PHASE], getVal((uint32_t*) raw));
 
-    v = 180. *  _FIX_18_17(*raw);
+    v = pcavRefConv<PCAV_REF_PHASE>(*raw);
 
     return v;
 }
@@ -665,9 +662,9 @@ double CpcavFwAdapt::getRefI(int32_t *raw)
 {
     double v;
 
-    CPSW_TRY_CATCH(rfRefI_->getVal((uint32_t*) raw));
+    CPSW_TRY_CATCH(refReg_[PCAV_REF_I], getVal((uint32_t*) raw));
 
-    v = _FIX_18_17(*raw);
+    v = pcavRefConv<PCAV_REF_I>(*raw);
 
     return v;
 }
@@ -676,9 +673,9 @@ double CpcavFwAdapt::getRefQ(int32_t *raw)
 {
     double v;
 
-    CPSW_TRY_CATCH(rfRefQ_->getVal((uint32_t*) raw));
+    CPSW_TRY_CATCH(refReg_[PCAV_REF_Q], getVal((uint32_t*) raw));
 
-    v = _FIX_18_17(*raw);
+    v = pcavRefConv<PCAV_REF_Q>(*raw);
 
     return v;
 }
@@ -693,452 +690,219 @@ double CpcavFwAdapt::getRefQ(int32_t *raw)
 
 double CpcavFwAdapt::getIfAmpl(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IfAmpl_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IfAmpl_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IfAmpl_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IfAmpl_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-
-    v = _FIX_18_17(*raw);
-
-    return v;
+    return probeField<PCAV_IF_AMPL>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getIfPhase(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IfPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IfPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IfPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IfPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-
-    v = 180. * _FIX_18_17(*raw);
-
-    return v;
+    return probeField<PCAV_IF_PHASE>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getIfI(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IfI_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IfI_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IfI_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IfI_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-
-    v = _FIX_18_17(*raw);
-
-    return v;
+    return probeField<PCAV_IF_I>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getIfQ(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IfQ_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IfQ_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IfQ_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IfQ_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-  
-    v = _FIX_18_17(*raw);
-
-    return v;
+    return probeField<PCAV_IF_Q>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getDCReal(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1DCReal_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2DCReal_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1DCReal_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2DCReal_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-
-    v = _FIX_18_16(*raw);
-
-    return v;
+    return probeField<PCAV_DC_REAL>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getDCImage(int cavity, int probe, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1DCImage_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2DCImage_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1DCImage_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2DCImage_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
-
-    v = _FIX_18_16(*raw);
-
-    return v;
+    return probeField<PCAV_DC_IMAGE>(cavity, probe, raw);
 }
 
 double CpcavFwAdapt::getDCFreq(int cavity, int probe, int32_t *raw)
 {
-    double v;
+    return probeField<PCAV_DC_FREQ>(cavity, probe, raw);
+}
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1DCFreq_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2DCFreq_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1DCFreq_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2DCFreq_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
+double CpcavFwAdapt::getIntegI(int cavity, int probe, int32_t *raw)
+{
+    return probeField<PCAV_INTEG_I>(cavity, probe, raw);
+}
 
-    v = _FIX_32_18(*raw);
+double CpcavFwAdapt::getIntegQ(int cavity, int probe, int32_t *raw)
+{
+    return probeField<PCAV_INTEG_Q>(cavity, probe, raw);
+}
 
-    return v;
+double CpcavFwAdapt::getOutPhase(int cavity, int probe, int32_t *raw)
+{
+    return probeField<PCAV_OUT_PHASE>(cavity, probe, raw);
 }
 
-double CpcavFwAdapt::getIntegI(int cavity, int probe, int32_t *raw)
+double CpcavFwAdapt::getOutAmpl(int cavity, int probe, int32_t *raw)
 {
-    double v;
+    return probeField<PCAV_OUT_AMPL>(cavity, probe, raw);
+}
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IntegI_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IntegI_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IntegI_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IntegI_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-    }
 
-    v = _FIX_18_16(*raw);
 
-    return v;
+double CpcavFwAdapt::getCompPhase(int cavity, int probe, int32_t *raw)
+{
+    return probeField<PCAV_COMP_PHASE>(cavity, probe, raw);
 }
 
-double CpcavFwAdapt::getIntegQ(int cavity, int probe, int32_t *raw)
+
+double CpcavFwAdapt::getPhaseOffset(int cavity, int probe, int32_t *raw)
 {
-    double v;
+    return settingField<pcavPhaseOffsetFmt>(cavity, probe, PCAV_SETTING_PHASE_OFFSET, raw);
+}
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1IntegQ_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2IntegQ_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1IntegQ_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2IntegQ_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
+double CpcavFwAdapt::getWeight(int cavity, int probe, int32_t *raw)
+{
+    return settingField<pcavWeightFmt>(cavity, probe, PCAV_SETTING_WEIGHT, raw);
+}
+
+//
+//
+/* bulk monitor */
+//
+//
+
+double CpcavFwAdapt::getProbeField(int cavity, int probe, pcavProbeField field, int32_t *raw)
+{
+    if(!valid_probe(cavity, probe) || field < 0 || field >= PCAV_NUM_PROBE_FIELDS) {
+        *raw = 0;
+        return 0.;
     }
 
-    v = _FIX_18_16(*raw);
+    CPSW_TRY_CATCH(probeReg_[cavity][probe][field], getVal((uint32_t*) raw));
 
-    return v;
+    return convert(field, *raw);
 }
 
-double CpcavFwAdapt::getOutPhase(int cavity, int probe, int32_t *raw)
+double CpcavFwAdapt::getRefField(pcavRefField field, int32_t *raw)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1OutPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2OutPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1OutPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2OutPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
+    if(field < 0 || field >= PCAV_NUM_REF_FIELDS) {
+        *raw = 0;
+        return 0.;
     }
 
-    v = 180. * _FIX_18_15(*raw);
+    CPSW_TRY_CATCH(refReg_[field], getVal((uint32_t*) raw));
 
-    return v;
+    return convert(field, *raw);
 }
 
-double CpcavFwAdapt::getOutAmpl(int cavity, int probe, int32_t *raw)
+void CpcavFwAdapt::readSnapshot(pcavSnapshot *snap)
 {
-    double v;
+    for(int f = 0; f < PCAV_NUM_REF_FIELDS; f++) {
+        CPSW_TRY_CATCH(refReg_[f], getVal((uint32_t*) &snap->refRaw[f]));
+        snap->ref[f] = convert((pcavRefField) f, snap->refRaw[f]);
+    }
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1OutAmpl_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2OutAmpl_->getVal((uint32_t*) raw));
-                    break;
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            for(int f = 0; f < PCAV_NUM_PROBE_FIELDS; f++) {
+                CPSW_TRY_CATCH(probeReg_[c][p][f], getVal((uint32_t*) &snap->raw[c][p][f]));
+                snap->val[c][p][f] = convert((pcavProbeField) f, snap->raw[c][p][f]);
             }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1OutAmpl_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2OutAmpl_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
+        }
     }
-
-    v = _FIX_18_16(*raw);
-
-    return v;
 }
 
+// 32 bit latch count to a 64 bit pulse ID, monotonic across the counter wrap
+uint64_t CpcavFwAdapt::latchId(uint32_t count)
+{
+    if(!latchPrimed_) latchId_ = count;
+    else              latchId_ += (uint32_t) (count - (uint32_t) latchId_);
+    latchPrimed_ = true;
 
+    return latchId_;
+}
 
-double CpcavFwAdapt::getCompPhase(int cavity, int probe, int32_t *raw)
+void CpcavFwAdapt::getSnapshot(pcavSnapshot *snap)
 {
-    double v;
+    uint32_t count;
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1CompPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2CompPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1CompPhase_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2CompPhase_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
+    clock_gettime(CLOCK_REALTIME, &snap->ts);
+    if(latchCnt_) {
+        CPSW_TRY_CATCH(latchCnt_, getVal(&count));
+        snap->pulseId = latchId(count);
     }
+    else snap->pulseId = pulseId_++;
+    snap->flags   = latchFlags_;
+    snap->retries = 0;
 
-    v = 180. * _FIX_18_15(*raw);
-
-    return v;
+    readSnapshot(snap);
+    pcavMetricAdd(PCAV_M_SNAPSHOTS, 1);
 }
 
-
-double CpcavFwAdapt::getPhaseOffset(int cavity, int probe, int32_t *raw)
+bool CpcavFwAdapt::getSnapshotCoherent(pcavSnapshot *snap, int maxRetry)
 {
-    double v;
+    uint32_t before = 0, after = 0;
+    bool     ok = false;
 
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1PhaseOffset_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2PhaseOffset_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1PhaseOffset_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2PhaseOffset_->getVal((uint32_t*) raw));
-                    break;
+    coherentStats_.reads++;
+
+    for(int t = 0; t <= maxRetry && !ok; t++) {
+        ok = true;
+        clock_gettime(CLOCK_REALTIME, &snap->ts);
+        if(latchCnt_) CPSW_TRY_CATCH(latchCnt_, getVal(&before));
+
+        readSnapshot(snap);
+
+        if(latchCnt_) {
+            CPSW_TRY_CATCH(latchCnt_, getVal(&after));
+            ok = (before == after);
+        }
+        else {
+            // the first register of the read and the first latched register of each cavity, read again at the end
+            CPSW_TRY_CATCH(refReg_[0], getVal(&after));
+            ok = ((int32_t) after == snap->refRaw[0]);
+            for(int c = 0; c < PCAV_NUM_CAVITY && ok; c++) {
+                CPSW_TRY_CATCH(probeReg_[c][0][PCAV_IF_AMPL], getVal(&after));
+                ok = ((int32_t) after == snap->raw[c][0][PCAV_IF_AMPL]);
             }
-            break;
+        }
+
+        snap->retries = t;
+        pcavMetricAdd(PCAV_M_SNAPSHOTS, 1);
+        if(!ok) {
+            coherentStats_.torn++;
+            pcavMetricAdd(PCAV_M_COHERENT_RETRIES, 1);
+        }
     }
 
-    v = 180. * _FIX_18_15(*raw);
+    // one numbering for every snapshot, a torn read takes the latch it started in,
+    // the next read starts at or after the latch that tore it, so IDs stay increasing
+    snap->pulseId = latchCnt_ ? latchId(before) : pulseId_++;
+    snap->flags   = (ok ? PCAV_SNAP_COHERENT : PCAV_SNAP_TORN) | latchFlags_;
+    if(!ok) {
+        coherentStats_.failures++;
+        pcavMetricAdd(PCAV_M_COHERENT_FAILURES, 1);
+    }
 
-    return v;
+    return ok;
 }
 
-double CpcavFwAdapt::getWeight(int cavity, int probe, int32_t *raw)
+void CpcavFwAdapt::setLatchCounter(const char *name, bool timingId)
 {
-    double v;
-
-    switch(cavity) {
-        case 0:
-            switch(probe) {
-                case 0:    // cavity 0, probe 0
-                    CPSW_TRY_CATCH(cav1P1Weight_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 0, probe 1
-                    CPSW_TRY_CATCH(cav1P2Weight_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
-        case 1:
-            switch(probe) {
-                case 0:    // cavity 1, probe 0
-                    CPSW_TRY_CATCH(cav2P1Weight_->getVal((uint32_t*) raw));
-                    break;
-                case 1:    // cavity 1, probe 1
-                    CPSW_TRY_CATCH(cav2P2Weight_->getVal((uint32_t*) raw));
-                    break;
-            }
-            break;
+    latchPrimed_ = false;
+    latchFlags_  = 0;
+    if(!name || !*name) {
+        latchCnt_.reset();
+        return;
     }
 
-    v = _FIX_2_1(*raw);
+    CPSW_TRY_CATCH_AT(name, 0, latchCnt_ = IScalVal_RO::create(pPcavReg_->findByName(name)));
+    latchFlags_ = timingId ? PCAV_SNAP_HW_ID : 0;
+}
 
-    return v;
+void CpcavFwAdapt::getCoherentStats(pcavCoherentStats *stats)
+{
+    *stats = coherentStats_;
+}
+
+void CpcavFwAdapt::clearCoherentStats(void)
+{
+    memset(&coherentStats_, 0, sizeof(coherentStats_));
 }
 
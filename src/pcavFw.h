@@ -12,6 +12,60 @@
 
 #include <cpsw_api_user.h>
 #include <cpsw_api_builder.h>
+#include <time.h>
+
+#define PCAV_NUM_CAVITY   2
+#define PCAV_NUM_PROBE    2
+
+/* per probe monitor fields, in the order of the snapshot arrays */
+typedef enum {
+    PCAV_IF_AMPL = 0,
+    PCAV_IF_PHASE,
+    PCAV_IF_I,
+    PCAV_IF_Q,
+    PCAV_DC_REAL,
+    PCAV_DC_IMAGE,
+    PCAV_DC_FREQ,
+    PCAV_INTEG_I,
+    PCAV_INTEG_Q,
+    PCAV_OUT_PHASE,
+    PCAV_OUT_AMPL,
+    PCAV_COMP_PHASE,
+    PCAV_NUM_PROBE_FIELDS
+} pcavProbeField;
+
+/* rf reference monitor fields */
+typedef enum {
+    PCAV_REF_AMPL = 0,
+    PCAV_REF_PHASE,
+    PCAV_REF_I,
+    PCAV_REF_Q,
+    PCAV_NUM_REF_FIELDS
+} pcavRefField;
+
+#define PCAV_SNAP_COHERENT   0x1     // all latched registers verified to come from the same pulse
+#define PCAV_SNAP_TORN       0x2     // coherent read gave up, data may span two pulses
+#define PCAV_SNAP_HW_ID      0x4     // pulseId is the timing system pulse ID, the same on every board
+
+/* all monitor registers of one pulse, raw register words and converted values */
+struct pcavSnapshot {
+    uint64_t         pulseId;       // latch counter extended to 64 bit if configured, otherwise sequence number of the snapshot
+    struct timespec  ts;            // CLOCK_REALTIME at the start of the read
+    uint32_t         flags;         // PCAV_SNAP_xxx
+    uint32_t         retries;       // re-reads needed by the coherent read
+
+    int32_t   refRaw[PCAV_NUM_REF_FIELDS];
+    double    ref[PCAV_NUM_REF_FIELDS];
+
+    int32_t   raw[PCAV_NUM_CAVITY][PCAV_NUM_PROBE][PCAV_NUM_PROBE_FIELDS];
+    double    val[PCAV_NUM_CAVITY][PCAV_NUM_PROBE][PCAV_NUM_PROBE_FIELDS];
+};
+
+struct pcavCoherentStats {
+    uint64_t  reads;         // coherent snapshot requests
+    uint64_t  torn;          // attempts which straddled a latch and were retried
+    uint64_t  failures;      // requests which ran out of retries
+};
 
 class IpcavFw;
 typedef shared_ptr <IpcavFw> pcavFw;
@@ -20,6 +74,20 @@ class IpcavFw : public virtual IEntry {
 public:
     static pcavFw create(Path p);
 
+    /* register word conversion, same scaling as the setters */
+    static uint32_t ncoWord(double v);
+    static uint32_t phaseOffsetWord(double v);
+    static uint32_t calibCoeffWord(double v);
+    static uint32_t weightWord(double v);
+
+    /* register word back to the setter argument it stands for */
+    static double   phaseOffsetValue(uint32_t word);
+    static double   calibCoeffValue(uint32_t word);
+
+    /* raw register word to engineering unit, same conversion as the getters */
+    static double convert(pcavProbeField field, int32_t raw);
+    static double convert(pcavRefField field, int32_t raw);
+
     virtual void getVersion(int32_t *version) = 0;
     virtual void setRefSel(uint32_t channel) = 0;
 
@@ -37,6 +105,12 @@ public:
     virtual uint32_t setPhaseOffset(int cavity, int probe, double v) = 0;
     virtual uint32_t setWeight(int cavity, int probe, double v) = 0;
 
+    /* write precomputed register words, no conversion */
+    virtual void setNCORaw(int cavity, uint32_t word) = 0;
+    virtual void setPhaseOffsetRaw(int cavity, int probe, uint32_t word) = 0;
+    virtual void setCalibCoeffRaw(int cavity, int probe, uint32_t word) = 0;
+    virtual void setWeightRaw(int cavity, int probe, uint32_t word) = 0;
+
     virtual double getRefAmpl(int32_t *raw) = 0;
     virtual double getRefPhase(int32_t *raw) = 0;
     virtual double getRefI(int32_t *raw) = 0;
@@ -56,6 +130,28 @@ public:
     virtual double getCompPhase(int cavity, int probe, int32_t *raw) = 0;
     virtual double getPhaseOffset(int cavity, int probe, int32_t *raw) = 0;
     virtual double getWeight(int cavity, int probe, int32_t *raw) = 0;
+
+    /* single monitor field, the same register and conversion as the snapshot
+       out of range indices read nothing, raw and the result are 0 */
+    virtual double getProbeField(int cavity, int probe, pcavProbeField field, int32_t *raw) = 0;
+    virtual double getRefField(pcavRefField field, int32_t *raw) = 0;
+
+    /* read all monitor registers for both cavities into one snapshot */
+    virtual void getSnapshot(pcavSnapshot *snap) = 0;
+
+    /* snapshot bracketed by a latch check, retried while the read straddles a latch
+       the check uses the latch counter register if one is configured, otherwise it
+       re-reads the first register of the read and the first latched register of each
+       cavity after the snapshot, a register which holds its value over the latch is
+       not detected by the fallback
+       the latch counter, when configured, numbers all snapshots, coherent, torn or plain
+       a latch counter counts from wherever the board's counter stood, boards whose counters were not
+       reset together number the same pulse differently; timingId declares that the register latches
+       the timing system pulse ID instead, only then the snapshots carry PCAV_SNAP_HW_ID */
+    virtual bool getSnapshotCoherent(pcavSnapshot *snap, int maxRetry = 3) = 0;
+    virtual void setLatchCounter(const char *name, bool timingId = false) = 0;    // register under PcavReg, 0 to remove
+    virtual void getCoherentStats(pcavCoherentStats *stats) = 0;
+    virtual void clearCoherentStats(void) = 0;
     
 };
 
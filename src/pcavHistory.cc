@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavHistory.h"
+#include "pcavMetrics.h"
+
+
+CpcavHistory::CpcavHistory(size_t depth):
+    ring_(depth ? depth : 1)
+{
+    clear();
+}
+
+void CpcavHistory::clear(void)
+{
+    head_     = 0;
+    count_    = 0;
+    overruns_ = 0;
+}
+
+pcavSnapshot *CpcavHistory::next(void)
+{
+    return &ring_[head_];
+}
+
+void CpcavHistory::push(void)
+{
+    head_ = (head_ + 1) % ring_.size();
+    if(count_ < ring_.size()) count_++;
+    else {
+        overruns_++;
+        pcavMetricAdd(PCAV_M_HISTORY_OVERRUNS, 1);
+    }
+}
+
+void CpcavHistory::push(const pcavSnapshot &snap)
+{
+    ring_[head_] = snap;
+    push();
+}
+
+const pcavSnapshot *CpcavHistory::get(size_t age) const
+{
+    if(age >= count_) return 0;
+
+    return &ring_[(head_ + ring_.size() - 1 - age) % ring_.size()];
+}
+
+size_t CpcavHistory::series(int cavity, int probe, pcavProbeField field, size_t n, double *out) const
+{
+    if(n > count_) n = count_;
+
+    for(size_t i = 0; i < n; i++) out[i] = get(n - 1 - i)->val[cavity][probe][field];
+
+    return n;
+}
+
+size_t CpcavHistory::seriesRaw(int cavity, int probe, pcavProbeField field, size_t n, int32_t *out) const
+{
+    if(n > count_) n = count_;
+
+    for(size_t i = 0; i < n; i++) out[i] = get(n - 1 - i)->raw[cavity][probe][field];
+
+    return n;
+}
@@ -0,0 +1,47 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVHISTORY_H
+#define _PCAVHISTORY_H
+
+#include <vector>
+#include "pcavFw.h"
+
+// fixed size pulse history, the ring is allocated once at construction
+class CpcavHistory {
+private:
+    std::vector<pcavSnapshot> ring_;
+    size_t    head_;           // next slot to write
+    size_t    count_;
+    uint64_t  overruns_;       // oldest snapshots dropped since clear()
+
+public:
+    CpcavHistory(size_t depth);
+
+    size_t    capacity(void) const { return ring_.size(); }
+    size_t    size(void) const     { return count_; }
+    uint64_t  overruns(void) const { return overruns_; }
+    size_t    head(void) const     { return head_; }
+    const pcavSnapshot *ring(void) const { return &ring_[0]; }    // slot order, for zero-copy views
+    void      clear(void);
+
+    // slot for the next snapshot, fill it in place and commit with push()
+    pcavSnapshot *next(void);
+    void      push(void);
+    void      push(const pcavSnapshot &snap);
+
+    // age 0 is the newest snapshot, returns 0 if age >= size()
+    const pcavSnapshot *get(size_t age) const;
+
+    // copy one field of the last n snapshots into out[], oldest first, returns the number copied
+    size_t    series(int cavity, int probe, pcavProbeField field, size_t n, double *out) const;
+    size_t    seriesRaw(int cavity, int probe, pcavProbeField field, size_t n, int32_t *out) const;
+};
+
+#endif /* _PCAVHISTORY_H */
@@ -0,0 +1,229 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavJoin.h"
+#include "pcavMetrics.h"
+#include "pcavUtil.h"
+
+#include <string.h>
+#include <time.h>
+
+
+CpcavJoin::CpcavJoin(int nBoards, const pcavJoinConfig &config):
+    nBoards_(nBoards < 1 ? 1 : (nBoards > PCAV_JOIN_MAX_BOARDS ? PCAV_JOIN_MAX_BOARDS : nBoards)),
+    config_(config)
+{
+    if(config_.queueDepth < 1)   config_.queueDepth   = 1;
+    if(config_.window < 1)       config_.window       = 1;
+    if(config_.historyDepth < 1) config_.historyDepth = 1;
+
+    allMask_ = nBoards_ == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << nBoards_) - 1);
+
+    queue_.resize(nBoards_);
+    queueRing_.resize((size_t) nBoards_ * config_.queueDepth);
+    for(int b = 0; b < nBoards_; b++) {
+        queue_[b].head = 0;
+        queue_[b].tail = 0;
+        queue_[b].full = 0;
+        queue_[b].noHwId = 0;
+        queue_[b].ring = &queueRing_[(size_t) b * config_.queueDepth];
+    }
+
+    pendId_.resize(config_.window);
+    pendMask_.resize(config_.window);
+    pendTime_.resize(config_.window);
+    pendSnap_.resize((size_t) config_.window * nBoards_);
+    for(unsigned s = 0; s < config_.window; s++) pendMask_[s] = 0;
+    pending_     = 0;
+    emittedAny_  = false;
+    lastEmitted_ = 0;
+
+    record_.resize(config_.historyDepth);
+    histSnap_.resize((size_t) config_.historyDepth * nBoards_);
+    head_  = 0;
+    count_ = 0;
+
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool CpcavJoin::push(int board, const pcavSnapshot &snap)
+{
+    if(board < 0 || board >= nBoards_) return false;
+
+    queue   &q = queue_[board];
+
+    if(!(snap.flags & PCAV_SNAP_HW_ID)) {
+        __atomic_fetch_add(&q.noHwId, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    uint64_t h = __atomic_load_n(&q.head, __ATOMIC_RELAXED);
+    uint64_t t = __atomic_load_n(&q.tail, __ATOMIC_ACQUIRE);
+
+    if(h - t >= config_.queueDepth) {
+        __atomic_fetch_add(&q.full, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    q.ring[h % config_.queueDepth] = snap;
+    __atomic_store_n(&q.head, h + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// pending slot of the pulse ID, a new one if it is not pending yet
+int CpcavJoin::slot(uint64_t pulseId, uint64_t now)
+{
+    int free = -1;
+
+    for(unsigned s = 0; s < config_.window; s++) {
+        if(!pendMask_[s]) {
+            if(free < 0) free = s;
+        }
+        else if(pendId_[s] == pulseId) return s;
+    }
+
+    if(free < 0) {
+        // window full, make room by emitting the oldest, unless the new pulse is older still:
+        // it could only be emitted right away and out of order, it is dropped as late instead
+        unsigned oldest = 0;
+        for(unsigned s = 1; s < config_.window; s++) if(pendId_[s] < pendId_[oldest]) oldest = s;
+        if(pulseId < pendId_[oldest]) return -1;
+        emit(oldest, PCAV_JOIN_OVERFLOW);
+        free = oldest;
+    }
+
+    pendId_[free]   = pulseId;
+    pendTime_[free] = now;
+    pending_++;
+
+    return free;
+}
+
+void CpcavJoin::emit(int s, uint32_t flags)
+{
+    pcavJoinRecord &r  = record_[head_];
+    pcavSnapshot   *out = &histSnap_[head_ * nBoards_];
+    pcavSnapshot   *in  = &pendSnap_[(size_t) s * nBoards_];
+    uint64_t        present = pendMask_[s];
+
+    r.pulseId  = pendId_[s];
+    r.present  = present;
+    r.missing  = allMask_ & ~present;
+    r.flags    = flags;
+    r.reserved = 0;
+    for(int b = 0; b < nBoards_; b++) {
+        if(present & ((uint64_t) 1 << b)) out[b] = in[b];
+        else memset(&out[b], 0, sizeof(out[b]));
+    }
+
+    head_ = (head_ + 1) % record_.size();
+    if(count_ < record_.size()) count_++;
+
+    stats_.records++;
+    if(flags & PCAV_JOIN_COMPLETE) stats_.complete++;
+    if(flags & PCAV_JOIN_TIMEOUT)  stats_.timeouts++;
+    if(flags & PCAV_JOIN_OVERFLOW) stats_.overflows++;
+
+    emittedAny_  = true;
+    lastEmitted_ = pendId_[s];
+    pendMask_[s] = 0;
+    pending_--;
+}
+
+unsigned CpcavJoin::process(void)
+{
+    uint64_t now = now_ns();
+    uint64_t before = stats_.records;
+    uint64_t queued = 0;
+
+    // drain, bounded by what was queued when the drain started
+    for(int b = 0; b < nBoards_; b++) {
+        queue   &q = queue_[b];
+        uint64_t t = __atomic_load_n(&q.tail, __ATOMIC_RELAXED);
+        uint64_t h = __atomic_load_n(&q.head, __ATOMIC_ACQUIRE);
+
+        queued += h - t;
+        for(; t != h; t++) {
+            const pcavSnapshot &snap = q.ring[t % config_.queueDepth];
+            int s;
+
+            if((emittedAny_ && snap.pulseId <= lastEmitted_) || (s = slot(snap.pulseId, now)) < 0) stats_.late++;
+            else {
+                pendSnap_[(size_t) s * nBoards_ + b] = snap;
+                pendMask_[s] |= (uint64_t) 1 << b;
+            }
+        }
+        __atomic_store_n(&q.tail, t, __ATOMIC_RELEASE);
+    }
+
+    // emit in pulse ID order while the oldest pending pulse is complete or timed out
+    while(pending_) {
+        int oldest = -1;
+        for(unsigned s = 0; s < config_.window; s++) {
+            if(pendMask_[s] && (oldest < 0 || pendId_[s] < pendId_[oldest])) oldest = s;
+        }
+        if(pendMask_[oldest] == allMask_)                     emit(oldest, PCAV_JOIN_COMPLETE);
+        else if(now - pendTime_[oldest] >= config_.timeoutNs) emit(oldest, PCAV_JOIN_TIMEOUT);
+        else break;
+    }
+    pcavMetricSet(PCAV_M_JOIN_QUEUE_DEPTH, queued);
+    pcavMetricSet(PCAV_M_JOIN_PENDING, pending_);
+
+    return (unsigned) (stats_.records - before);
+}
+
+unsigned CpcavJoin::flush(void)
+{
+    uint64_t before = stats_.records;
+
+    process();
+    while(pending_) {
+        int oldest = -1;
+        for(unsigned s = 0; s < config_.window; s++) {
+            if(pendMask_[s] && (oldest < 0 || pendId_[s] < pendId_[oldest])) oldest = s;
+        }
+        emit(oldest, pendMask_[oldest] == allMask_ ? PCAV_JOIN_COMPLETE : PCAV_JOIN_TIMEOUT);
+    }
+
+    return (unsigned) (stats_.records - before);
+}
+
+const pcavJoinRecord *CpcavJoin::get(size_t age) const
+{
+    if(age >= count_) return 0;
+
+    return &record_[(head_ + record_.size() - 1 - age) % record_.size()];
+}
+
+const pcavSnapshot *CpcavJoin::snapshots(size_t age) const
+{
+    if(age >= count_) return 0;
+
+    return &histSnap_[((head_ + record_.size() - 1 - age) % record_.size()) * nBoards_];
+}
+
+void CpcavJoin::getStats(pcavJoinStats *stats)
+{
+    *stats = stats_;
+    stats->queueFull = 0;
+    stats->noHwId    = 0;
+    for(int b = 0; b < nBoards_; b++) {
+        stats->queueFull += __atomic_load_n(&queue_[b].full, __ATOMIC_RELAXED);
+        stats->noHwId    += __atomic_load_n(&queue_[b].noHwId, __ATOMIC_RELAXED);
+    }
+}
+
+void CpcavJoin::clearStats(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+    for(int b = 0; b < nBoards_; b++) {
+        __atomic_store_n(&queue_[b].full, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&queue_[b].noHwId, 0, __ATOMIC_RELAXED);
+    }
+}
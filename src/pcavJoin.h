@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVJOIN_H
+#define _PCAVJOIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "pcavFw.h"
+
+#define PCAV_JOIN_MAX_BOARDS  64
+
+// pulse ID aligned join of the snapshots of several boards
+// each board's acquisition thread push()es into its own lock-free single producer queue,
+// one consumer thread calls process(), which matches pulse IDs and appends joined records
+// to a contiguous multi-board history, in pulse ID order
+// boards are matched on pulseId, so it must be the timing system pulse ID on every board: a latch
+// register holding it (IpcavFw::setLatchCounter(name, true)) or the ID pcavPulseSync::waitForPulse()
+// returns from the timing stream, stored by the producer together with PCAV_SNAP_HW_ID; push() rejects
+// snapshots without the flag, the software sequence numbers and plain latch counters of IpcavFw count
+// from a board local start and do not line up
+struct pcavJoinConfig {
+    unsigned  queueDepth;      // snapshots per board queue
+    unsigned  window;          // pulse IDs pending at most, the oldest is emitted when the window is full
+    unsigned  historyDepth;    // joined records kept
+    uint64_t  timeoutNs;       // a pulse is emitted incomplete this long after its first snapshot arrived
+
+    pcavJoinConfig(): queueDepth(64), window(32), historyDepth(1024), timeoutNs(10000000) {}
+};
+
+#define PCAV_JOIN_COMPLETE    0x1
+#define PCAV_JOIN_TIMEOUT     0x2     // emitted incomplete after the timeout
+#define PCAV_JOIN_OVERFLOW    0x4     // emitted incomplete because the window was full
+
+struct pcavJoinRecord {
+    uint64_t  pulseId;
+    uint64_t  present;         // bit b set if board b reported
+    uint64_t  missing;         // bit b set if board b did not report, its snapshot is zeroed
+    uint32_t  flags;
+    uint32_t  reserved;
+};
+
+struct pcavJoinStats {
+    uint64_t  records;
+    uint64_t  complete;
+    uint64_t  timeouts;
+    uint64_t  overflows;
+    uint64_t  late;            // snapshots of a pulse ID already emitted, dropped
+    uint64_t  queueFull;       // snapshots dropped by push()
+    uint64_t  noHwId;          // snapshots rejected by push(), PCAV_SNAP_HW_ID not set
+};
+
+class CpcavJoin {
+private:
+    // single producer single consumer ring, head and tail on separate cache lines
+    struct queue {
+        uint64_t  head;
+        char      pad0[56];
+        uint64_t  tail;
+        char      pad1[56];
+        uint64_t  full;        // producer side counters
+        uint64_t  noHwId;
+        pcavSnapshot *ring;
+    };
+
+    int       nBoards_;
+    uint64_t  allMask_;
+    pcavJoinConfig config_;
+
+    std::vector<queue> queue_;
+    std::vector<pcavSnapshot> queueRing_;
+
+    // pending pulses, slots are unordered, the oldest is found by scanning
+    std::vector<uint64_t> pendId_;
+    std::vector<uint64_t> pendMask_;
+    std::vector<uint64_t> pendTime_;
+    std::vector<pcavSnapshot> pendSnap_;    // window x nBoards
+    unsigned  pending_;
+    bool      emittedAny_;
+    uint64_t  lastEmitted_;
+
+    // joined history, record i owns snapshots [i * nBoards, (i + 1) * nBoards)
+    std::vector<pcavJoinRecord> record_;
+    std::vector<pcavSnapshot> histSnap_;
+    size_t    head_;
+    size_t    count_;
+
+    pcavJoinStats stats_;
+
+    int       slot(uint64_t pulseId, uint64_t now);
+    void      emit(int s, uint32_t flags);
+
+public:
+    CpcavJoin(int nBoards, const pcavJoinConfig &config);
+
+    int       boards(void) const { return nBoards_; }
+
+    // producer, one thread per board, false if the queue is full or the snapshot has no hardware pulse ID
+    bool      push(int board, const pcavSnapshot &snap);
+
+    // consumer, drains the queues and emits due records, returns the number emitted
+    unsigned  process(void);
+    unsigned  flush(void);          // emit everything pending, incomplete or not
+
+    // age 0 is the newest record, 0 if age >= size()
+    size_t    size(void) const     { return count_; }
+    size_t    capacity(void) const { return record_.size(); }
+    const pcavJoinRecord *get(size_t age) const;
+    const pcavSnapshot   *snapshots(size_t age) const;    // boards() contiguous snapshots of the record
+
+    void      getStats(pcavJoinStats *stats);
+    void      clearStats(void);
+};
+
+#endif /* _PCAVJOIN_H */
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavKalman.h"
+#include "pcavUtil.h"
+
+#include <string.h>
+#include <math.h>
+
+
+CpcavKalman::CpcavKalman()
+{
+    pcavKalmanConfig c;
+
+    c.dt       = 1. / 120.;
+    c.qPhase   = 1.E-3;
+    c.qRate    = 1.E-3;
+    c.r0       = 1.E-2;
+    c.freqGain = 0.;
+    c.gate     = 5.;
+    c.minAmpl  = 0.;
+
+    for(int i = 0; i < PCAV_NUM_CAVITY; i++) setConfig(i, c);
+}
+
+void CpcavKalman::setConfig(int cavity, const pcavKalmanConfig &config)
+{
+    if(cavity < 0 || cavity >= PCAV_NUM_CAVITY) return;
+
+    config_[cavity] = config;
+    reset(cavity);
+}
+
+void CpcavKalman::reset(int cavity)
+{
+    if(cavity < 0 || cavity >= PCAV_NUM_CAVITY) return;
+
+    memset(&state_[cavity], 0, sizeof(pcavKalmanState));
+}
+
+// scalar update with the phase of one probe, H = [1 0]
+void CpcavKalman::measure(pcavKalmanState *s, const pcavKalmanConfig *c, double z, double ampl)
+{
+    if(isnan(z) || fabs(ampl) <= c->minAmpl || ampl == 0.) return;
+
+    double R  = c->r0 / (ampl * ampl);
+    double y  = wrap_phase(z - s->phase);
+    double S  = s->P[0][0] + R;
+
+    if(c->gate > 0. && y * y > c->gate * c->gate * S) {
+        s->rejected++;
+        return;
+    }
+
+    double k0 = s->P[0][0] / S;
+    double k1 = s->P[1][0] / S;
+
+    s->phase = wrap_phase(s->phase + k0 * y);
+    s->rate += k1 * y;
+
+    double p00 = s->P[0][0], p01 = s->P[0][1];
+    s->P[0][0] -= k0 * p00;
+    s->P[0][1] -= k0 * p01;
+    s->P[1][0] -= k1 * p00;
+    s->P[1][1] -= k1 * p01;
+}
+
+void CpcavKalman::update(const pcavSnapshot &snap)
+{
+    for(int cav = 0; cav < PCAV_NUM_CAVITY; cav++) {
+        pcavKalmanState  *s = &state_[cav];
+        pcavKalmanConfig *c = &config_[cav];
+        double dt = c->dt;
+
+        if(!s->valid) {
+            // start from the stronger probe with a wide covariance
+            int p = fabs(snap.val[cav][0][PCAV_IF_AMPL]) >= fabs(snap.val[cav][1][PCAV_IF_AMPL]) ? 0 : 1;
+            s->phase   = snap.val[cav][p][PCAV_OUT_PHASE];
+            s->rate    = 0.;
+            s->P[0][0] = 180. * 180.;
+            s->P[1][1] = 180. * 180. / (dt * dt);
+            s->P[0][1] = s->P[1][0] = 0.;
+            s->valid   = true;
+        }
+        else {
+            // predict, F = [1 dt; 0 1], drift input from DCFreq
+            double drift = 0.;
+            for(int p = 0; p < PCAV_NUM_PROBE; p++) drift += snap.val[cav][p][PCAV_DC_FREQ];
+            drift *= c->freqGain / PCAV_NUM_PROBE;
+
+            s->phase = wrap_phase(s->phase + (s->rate + drift) * dt);
+
+            double p00 = s->P[0][0] + dt * (s->P[1][0] + s->P[0][1]) + dt * dt * s->P[1][1];
+            double p01 = s->P[0][1] + dt * s->P[1][1];
+            double p11 = s->P[1][1];
+            // white noise on phase and on rate
+            p00 += c->qPhase * dt + c->qRate * dt * dt * dt / 3.;
+            p01 += c->qRate * dt * dt / 2.;
+            p11 += c->qRate * dt;
+            s->P[0][0] = p00;
+            s->P[0][1] = s->P[1][0] = p01;
+            s->P[1][1] = p11;
+        }
+
+        for(int p = 0; p < PCAV_NUM_PROBE; p++)
+            measure(s, c, snap.val[cav][p][PCAV_OUT_PHASE], snap.val[cav][p][PCAV_IF_AMPL]);
+
+        s->updates++;
+    }
+}
+
+void CpcavKalman::getState(int cavity, pcavKalmanState *state)
+{
+    if(cavity < 0 || cavity >= PCAV_NUM_CAVITY) return;
+
+    *state = state_[cavity];
+}
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVKALMAN_H
+#define _PCAVKALMAN_H
+
+#include "pcavFw.h"
+
+// per cavity phase tracker, state is phase (degree) and phase rate (degree/s)
+// both probes' OutPhase are fused with a measurement variance r0 / IfAmpl^2,
+// the mean DCFreq of the probes drives the phase as a known input
+struct pcavKalmanConfig {
+    double    dt;              // seconds per pulse
+    double    qPhase;          // phase random walk, degree^2/s
+    double    qRate;           // rate random walk, (degree/s)^2/s
+    double    r0;              // measurement variance at unit amplitude, degree^2
+    double    freqGain;        // phase drift per DCFreq unit, degree/s, 0 to ignore DCFreq
+    double    gate;            // reject a probe whose innovation exceeds gate sigma, 0 for no gating
+    double    minAmpl;         // ignore a probe below this IfAmpl
+};
+
+struct pcavKalmanState {
+    bool      valid;
+    double    phase;           // filtered phase, degree
+    double    rate;            // degree/s
+    double    P[2][2];         // covariance
+    uint64_t  updates;
+    uint64_t  rejected;        // probe measurements dropped by the gate
+};
+
+class CpcavKalman {
+private:
+    pcavKalmanConfig config_[PCAV_NUM_CAVITY];
+    pcavKalmanState  state_[PCAV_NUM_CAVITY];
+
+    void  measure(pcavKalmanState *s, const pcavKalmanConfig *c, double z, double ampl);
+
+public:
+    CpcavKalman();
+
+    void  setConfig(int cavity, const pcavKalmanConfig &config);
+    void  reset(int cavity);
+
+    // one predict/update step for both cavities, constant time, no allocation
+    void  update(const pcavSnapshot &snap);
+
+    void  getState(int cavity, pcavKalmanState *state);
+};
+
+#endif /* _PCAVKALMAN_H */
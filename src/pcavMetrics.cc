@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavMetrics.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+uint64_t pcavMetricVal[PCAV_M_NUM];
+
+static const struct {
+    const char *name;
+    const char *type;
+    const char *help;
+    double      scale;
+} metric_desc[PCAV_M_NUM] = {
+    { "pcav_bus_transactions_total",     "counter", "Register reads and writes issued by pcavLib", 1. },
+    { "pcav_bus_errors_total",           "counter", "CPSW errors on register accesses", 1. },
+    { "pcav_snapshots_total",            "counter", "Snapshots read", 1. },
+    { "pcav_coherent_retries_total",     "counter", "Coherent snapshot reads retried after straddling a latch", 1. },
+    { "pcav_coherent_failures_total",    "counter", "Coherent snapshot reads which ran out of retries", 1. },
+    { "pcav_history_overruns_total",     "counter", "History entries dropped before being read", 1. },
+    { "pcav_alarm_events_dropped_total", "counter", "Alarm transitions lost to a full event list", 1. },
+    { "pcav_poll_cycles_total",          "counter", "Poll cycles timed", 1. },
+    { "pcav_poll_duration_seconds_sum",  "counter", "Total time spent in poll cycles", 1.E-9 },
+    { "pcav_poll_duration_seconds_max",  "gauge",   "Longest poll cycle", 1.E-9 },
+    { "pcav_poll_duration_seconds_last", "gauge",   "Last poll cycle", 1.E-9 },
+    { "pcav_poll_bus_transactions_last", "gauge",   "Bus transactions during the last poll cycle", 1. },
+    { "pcav_poll_bus_transactions_max",  "gauge",   "Most bus transactions in one poll cycle", 1. },
+    { "pcav_alarm_queue_depth",          "gauge",   "Alarm events waiting to be collected", 1. },
+    { "pcav_join_queue_depth",           "gauge",   "Snapshots queued to the pulse ID join", 1. },
+    { "pcav_join_pending_pulses",        "gauge",   "Pulses waiting in the join window", 1. },
+};
+
+
+void CpcavPollTimer::start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_);
+    bus_ = pcavMetricGet(PCAV_M_BUS_TRANSACTIONS);
+}
+
+void CpcavPollTimer::stop(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t) (now.tv_sec - start_.tv_sec) * 1000000000ULL + now.tv_nsec - start_.tv_nsec;
+
+    pcavMetricAdd(PCAV_M_POLL_CYCLES, 1);
+    pcavMetricAdd(PCAV_M_POLL_NS_SUM, ns);
+    pcavMetricMax(PCAV_M_POLL_NS_MAX, ns);
+    pcavMetricSet(PCAV_M_POLL_NS_LAST, ns);
+
+    uint64_t bus = pcavMetricGet(PCAV_M_BUS_TRANSACTIONS) - bus_;
+    pcavMetricSet(PCAV_M_POLL_BUS_LAST, bus);
+    pcavMetricMax(PCAV_M_POLL_BUS_MAX, bus);
+}
+
+
+CpcavMetricsExporter::CpcavMetricsExporter(const char *path, double period, bool socket, const char *labels):
+    period_(period > 0. ? period : 1.),
+    socket_(socket),
+    fd_(-1),
+    run_(false),
+    hasProfile_(false)
+{
+    snprintf(path_, sizeof(path_), "%s", path);
+    snprintf(labels_, sizeof(labels_), "%s", labels ? labels : "");
+}
+
+CpcavMetricsExporter::~CpcavMetricsExporter()
+{
+    stop();
+}
+
+// whole metrics only, a metric which does not fit is dropped with everything after it
+int CpcavMetricsExporter::format(char *buf, int len)
+{
+    int n = 0, done = 0;
+
+    for(int m = 0; m < PCAV_M_NUM; m++, done = n) {
+        uint64_t v = pcavMetricGet((pcavMetric) m);
+        n += snprintf(buf + n, len - n, "# HELP %s %s\n# TYPE %s %s\n",
+                      metric_desc[m].name, metric_desc[m].help, metric_desc[m].name, metric_desc[m].type);
+        if(n >= len) break;
+        if(labels_[0]) n += snprintf(buf + n, len - n, "%s{%s} ", metric_desc[m].name, labels_);
+        else           n += snprintf(buf + n, len - n, "%s ", metric_desc[m].name);
+        if(n >= len) break;
+        if(metric_desc[m].scale == 1.) n += snprintf(buf + n, len - n, "%llu\n", (unsigned long long) v);
+        else                           n += snprintf(buf + n, len - n, "%.9g\n", v * metric_desc[m].scale);
+        if(n >= len) break;
+    }
+
+    return done;
+}
+
+void CpcavMetricsExporter::writeFile(void)
+{
+    char tmp[sizeof(path_) + 8];
+    int  n = format(buf_, sizeof(buf_));
+
+    // node exporter textfile collectors must never see a partial file
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path_);
+    FILE *f = fopen(tmp, "w");
+    if(!f) return;
+    fwrite(buf_, 1, n, f);
+    if(fclose(f) == 0) rename(tmp, path_);
+    else               unlink(tmp);
+}
+
+void CpcavMetricsExporter::serve(void)
+{
+    struct pollfd p;
+    p.fd     = fd_;
+    p.events = POLLIN;
+
+    if(poll(&p, 1, (int) (period_ * 1000.)) <= 0) return;
+
+    int c = accept(fd_, 0, 0);
+    if(c < 0) return;
+
+    int n = format(buf_, sizeof(buf_));
+    for(int off = 0; off < n; ) {
+        ssize_t w = send(c, buf_ + off, n - off, MSG_NOSIGNAL);
+        if(w <= 0) break;
+        off += w;
+    }
+    close(c);
+}
+
+void *CpcavMetricsExporter::task(void *arg)
+{
+    CpcavMetricsExporter *e = (CpcavMetricsExporter *) arg;
+
+    if(e->hasProfile_) pcavRtApply(e->profile_);
+
+    while(e->run_) {
+        if(e->socket_) e->serve();
+        else {
+            e->writeFile();
+            struct timespec t;
+            t.tv_sec  = (time_t) e->period_;
+            t.tv_nsec = (long) ((e->period_ - t.tv_sec) * 1.E+9);
+            nanosleep(&t, 0);
+        }
+    }
+
+    return 0;
+}
+
+int CpcavMetricsExporter::start(const pcavRtProfile *profile)
+{
+    if(run_) return 0;
+
+    hasProfile_ = profile != 0;
+    if(profile) profile_ = *profile;
+
+    if(socket_) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_);
+
+        unlink(path_);
+        if((fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 ||
+           bind(fd_, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd_, 4)) {
+            fprintf(stderr, "pcavMetrics: socket %s failed (%s)\n", path_, strerror(errno));
+            if(fd_ >= 0) close(fd_);
+            fd_ = -1;
+            return -1;
+        }
+    }
+
+    run_ = true;
+    int err = pthread_create(&thread_, 0, task, this);
+    if(err) {
+        fprintf(stderr, "pcavMetrics: thread create failed (%s)\n", strerror(err));
+        run_ = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void CpcavMetricsExporter::stop(void)
+{
+    if(!run_) return;
+
+    run_ = false;
+    pthread_join(thread_, 0);
+
+    if(fd_ >= 0) {
+        close(fd_);
+        unlink(path_);
+        fd_ = -1;
+    }
+}
@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVMETRICS_H
+#define _PCAVMETRICS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "pcavRt.h"
+
+// library health counters, process wide
+// updates are relaxed atomics on the hot path, readers never take a lock
+typedef enum {
+    PCAV_M_BUS_TRANSACTIONS = 0,    // register reads and writes
+    PCAV_M_BUS_ERRORS,              // CPSWError caught on a register access
+    PCAV_M_SNAPSHOTS,
+    PCAV_M_COHERENT_RETRIES,        // coherent reads retried after straddling a latch
+    PCAV_M_COHERENT_FAILURES,       // coherent reads out of retries
+    PCAV_M_HISTORY_OVERRUNS,        // oldest history entries dropped
+    PCAV_M_ALARM_DROPPED,           // alarm transitions lost to a full event list
+    PCAV_M_POLL_CYCLES,
+    PCAV_M_POLL_NS_SUM,
+    PCAV_M_POLL_NS_MAX,             // gauge, worst cycle since start
+    PCAV_M_POLL_NS_LAST,            // gauge
+    PCAV_M_POLL_BUS_LAST,           // gauge, bus transactions during the last poll cycle, all threads
+    PCAV_M_POLL_BUS_MAX,            // gauge, most bus transactions in one poll cycle since start
+    PCAV_M_ALARM_QUEUE_DEPTH,       // gauge, alarm events waiting for clearEvents(), last evaluated instance
+    PCAV_M_JOIN_QUEUE_DEPTH,        // gauge, snapshots queued to the join over all boards, at the last process()
+    PCAV_M_JOIN_PENDING,            // gauge, pulses waiting in the join window, at the last process()
+    PCAV_M_NUM
+} pcavMetric;
+
+extern uint64_t pcavMetricVal[PCAV_M_NUM];
+
+inline void pcavMetricAdd(pcavMetric m, uint64_t v)
+{
+    __atomic_fetch_add(&pcavMetricVal[m], v, __ATOMIC_RELAXED);
+}
+
+inline void pcavMetricSet(pcavMetric m, uint64_t v)
+{
+    __atomic_store_n(&pcavMetricVal[m], v, __ATOMIC_RELAXED);
+}
+
+inline void pcavMetricMax(pcavMetric m, uint64_t v)
+{
+    uint64_t cur = __atomic_load_n(&pcavMetricVal[m], __ATOMIC_RELAXED);
+
+    while(v > cur && !__atomic_compare_exchange_n(&pcavMetricVal[m], &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+}
+
+inline uint64_t pcavMetricGet(pcavMetric m)
+{
+    return __atomic_load_n(&pcavMetricVal[m], __ATOMIC_RELAXED);
+}
+
+
+// times one poll cycle of the caller and counts the bus transactions issued meanwhile
+class CpcavPollTimer {
+private:
+    struct timespec start_;
+    uint64_t  bus_;
+
+public:
+    void  start(void);
+    void  stop(void);
+};
+
+
+// worst case of one metric, help and type lines plus the labelled sample
+#define PCAV_METRIC_TEXT_MAX  (384 + 128)
+
+// writes all counters in Prometheus text format every period,
+// to a file (replaced atomically) or to each client of a unix domain socket
+class CpcavMetricsExporter {
+private:
+    char      path_[108];
+    char      labels_[128];
+    double    period_;
+    bool      socket_;
+    int       fd_;
+    volatile bool run_;
+    pthread_t thread_;
+    pcavRtProfile profile_;
+    bool      hasProfile_;
+    char      buf_[PCAV_M_NUM * PCAV_METRIC_TEXT_MAX];    // exporter thread only
+
+    static void *task(void *arg);
+    int   format(char *buf, int len);
+    void  writeFile(void);
+    void  serve(void);
+
+public:
+    // labels, e.g. "ioc=\"sioc-xxx\"", are added to every sample, may be 0
+    CpcavMetricsExporter(const char *path, double period, bool socket, const char *labels = 0);
+    ~CpcavMetricsExporter();
+
+    // 0 on success, with the profile applied to the exporter thread when given
+    int   start(const pcavRtProfile *profile = 0);
+    void  stop(void);
+};
+
+#endif /* _PCAVMETRICS_H */
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavNco.h"
+
+#include <math.h>
+
+
+uint32_t pcavNcoWord(double v, double ref)
+{
+    const int64_t mod = (int64_t) 0x1 << PCAV_NCO_BITS;
+    // v * 2^N / ref is exact in long double for any realistic offset, round instead of truncating
+    int64_t k = (int64_t) llroundl(ldexpl((long double) v, PCAV_NCO_BITS) / (long double) ref);
+
+    k %= mod;                          // alias into one period of the accumulator
+    if(k >= mod/2)  k -= mod;          // then into the signed range
+    if(k < -mod/2)  k += mod;
+
+    return (uint32_t) (int32_t) k;
+}
+
+double pcavNcoFreq(uint32_t word, double ref)
+{
+    const uint32_t mask = ((uint32_t) 0x1 << PCAV_NCO_BITS) - 1;
+    int32_t k = (int32_t) (word & mask);
+
+    if(k & ((int32_t) 0x1 << (PCAV_NCO_BITS - 1))) k -= ((int32_t) 0x1 << PCAV_NCO_BITS);
+
+    return (double) ((long double) k * (long double) ref / ldexpl(1.L, PCAV_NCO_BITS));
+}
+
+
+CpcavNcoPlanner::CpcavNcoPlanner(double ref):
+    ref_(ref)
+{
+}
+
+void CpcavNcoPlanner::setRefClock(double ref)
+{
+    if(ref > 0.) ref_ = ref;
+}
+
+double CpcavNcoPlanner::getRefClock(void)
+{
+    return ref_;
+}
+
+double CpcavNcoPlanner::resolution(void)
+{
+    return ldexp(ref_, -PCAV_NCO_BITS);
+}
+
+void CpcavNcoPlanner::plan(double v, pcavNcoPlan *p)
+{
+    p->request  = v;
+    p->word     = pcavNcoWord(v, ref_);
+    p->achieved = pcavNcoFreq(p->word, ref_);
+    p->error    = p->achieved - v;
+}
+
+void CpcavNcoPlanner::plan(const double *v, int n, uint32_t *words, pcavNcoPlan *plans)
+{
+    for(int i = 0; i < n; i++) {
+        if(plans) {
+            plan(v[i], plans + i);
+            words[i] = plans[i].word;
+        }
+        else words[i] = pcavNcoWord(v[i], ref_);
+    }
+}
+
+void CpcavNcoPlanner::sweep(double start, double stop, int n, uint32_t *words, pcavNcoPlan *plans)
+{
+    double step = (n > 1) ? (stop - start) / (n - 1) : 0.;
+
+    for(int i = 0; i < n; i++) {
+        double v = start + step * i;
+        if(plans) {
+            plan(v, plans + i);
+            words[i] = plans[i].word;
+        }
+        else words[i] = pcavNcoWord(v, ref_);
+    }
+}
+
+void CpcavNcoPlanner::apply(pcavFw fw, int cavity, uint32_t word)
+{
+    fw->setNCORaw(cavity, word);
+}
+
+void CpcavNcoPlanner::applyBoth(pcavFw fw, uint32_t word0, uint32_t word1)
+{
+    fw->setNCORaw(0, word0);
+    fw->setNCORaw(1, word1);
+}
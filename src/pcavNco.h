@@ -0,0 +1,55 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVNCO_H
+#define _PCAVNCO_H
+
+#include <stdint.h>
+#include "pcavFw.h"
+
+#define PCAV_NCO_REF_CLOCK   1.7E+7     // nominal NCO reference clock, Hz
+#define PCAV_NCO_BITS        26         // phase increment width of cavNNCOPhaseAdj
+
+// phase increment word for frequency v, rounded to the nearest LSB
+// frequencies beyond +/- ref/2 alias into the signed range, negative increments are sign extended
+uint32_t pcavNcoWord(double v, double ref = PCAV_NCO_REF_CLOCK);
+// frequency produced by a phase increment word
+double   pcavNcoFreq(uint32_t word, double ref = PCAV_NCO_REF_CLOCK);
+
+
+struct pcavNcoPlan {
+    double    request;         // requested frequency, Hz
+    uint32_t  word;            // phase increment word
+    double    achieved;        // frequency the word produces, Hz
+    double    error;           // achieved - request, Hz
+};
+
+class CpcavNcoPlanner {
+private:
+    double    ref_;            // reference clock, Hz
+
+public:
+    CpcavNcoPlanner(double ref = PCAV_NCO_REF_CLOCK);
+
+    void      setRefClock(double ref);
+    double    getRefClock(void);
+    double    resolution(void);    // frequency of one LSB, Hz
+
+    void      plan(double v, pcavNcoPlan *p);
+    // precompute a table of words, plans may be null if only the words are wanted
+    void      plan(const double *v, int n, uint32_t *words, pcavNcoPlan *plans = 0);
+    // n points from start to stop, both included
+    void      sweep(double start, double stop, int n, uint32_t *words, pcavNcoPlan *plans = 0);
+
+    // write precomputed words, back-to-back with no conversion in between
+    void      apply(pcavFw fw, int cavity, uint32_t word);
+    void      applyBoth(pcavFw fw, uint32_t word0, uint32_t word1);
+};
+
+#endif /* _PCAVNCO_H */
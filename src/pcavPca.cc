@@ -0,0 +1,365 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavPca.h"
+#include "pcavUtil.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+// cyclic Jacobi, a is n x n symmetric and is destroyed, eigenvectors go to the columns of v
+static int jacobi(double *a, double *v, double *d, int n)
+{
+    int sweep;
+
+    for(int i = 0; i < n * n; i++) v[i] = 0.;
+    for(int i = 0; i < n; i++) v[i * n + i] = 1.;
+
+    for(sweep = 0; sweep < 50; sweep++) {
+        double off = 0., diag = 0.;
+        for(int p = 0; p < n; p++) {
+            diag += a[p * n + p] * a[p * n + p];
+            for(int q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+        }
+        if(off <= 1e-24 * diag) break;
+
+        for(int p = 0; p < n - 1; p++) {
+            for(int q = p + 1; q < n; q++) {
+                double apq = a[p * n + q];
+                if(apq == 0.) continue;
+
+                double theta = (a[q * n + q] - a[p * n + p]) / (2. * apq);
+                double t = (theta >= 0. ? 1. : -1.) / (fabs(theta) + sqrt(theta * theta + 1.));
+                double c = 1. / sqrt(t * t + 1.);
+                double s = t * c;
+
+                for(int k = 0; k < n; k++) {
+                    double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for(int k = 0; k < n; k++) {
+                    double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for(int k = 0; k < n; k++) {
+                    double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for(int i = 0; i < n; i++) d[i] = a[i * n + i];
+
+    return sweep;
+}
+
+
+CpcavPca::CpcavPca(const int *fields, int nFields, const pcavPcaConfig &config):
+    n_(0), config_(config), run_(false), hasProfile_(false)
+{
+    for(int i = 0; i < nFields && n_ < PCAV_PCA_MAX_FIELDS; i++) {
+        if(fields[i] >= 0 && fields[i] < PCAV_REC_FIELDS) field_[n_++] = fields[i];
+    }
+
+    if(!(config_.forget > 0. && config_.forget <= 1.)) config_.forget = 1.;
+    if(config_.block < PCAV_PCA_LANES) config_.block = PCAV_PCA_LANES;
+    config_.block = (config_.block + PCAV_PCA_LANES - 1) / PCAV_PCA_LANES * PCAV_PCA_LANES;
+    if(config_.components < 1) config_.components = 1;
+    if(config_.components > PCAV_PCA_MAX_COMPONENTS) config_.components = PCAV_PCA_MAX_COMPONENTS;
+    if(config_.intervalMs < 1) config_.intervalMs = 1;
+
+    // the last sample of a block has weight 1, the first forget ^ (block - 1)
+    x_.resize((size_t) n_ * config_.block);
+    wsqrt_.resize(config_.block);
+    blockWeight_ = 0.;
+    for(unsigned i = 0; i < config_.block; i++) {
+        double w = pow(config_.forget, (double) (config_.block - 1 - i));
+        wsqrt_[i] = sqrt(w);
+        blockWeight_ += w;
+    }
+    blockDecay_ = pow(config_.forget, (double) config_.block);
+
+    mean_.resize(n_);
+    delta_.resize(n_);
+    scatter_.resize((size_t) n_ * n_);
+    copyMean_.resize(n_);
+    copyScatter_.resize((size_t) n_ * n_);
+    a_.resize((size_t) n_ * n_);
+    v_.resize((size_t) n_ * n_);
+    d_.resize(n_);
+
+    pthread_mutex_init(&copyLock_, 0);
+    pthread_mutex_init(&resultLock_, 0);
+    want_ = 0;
+    copyValid_ = false;
+    resultValid_ = false;
+    memset(&result_, 0, sizeof(result_));
+    memset(&work_, 0, sizeof(work_));
+
+    reset();
+    clearStats();
+}
+
+CpcavPca::~CpcavPca()
+{
+    stop();
+    pthread_mutex_destroy(&copyLock_);
+    pthread_mutex_destroy(&resultLock_);
+}
+
+void CpcavPca::reset(void)
+{
+    fill_    = 0;
+    weight_  = 0.;
+    samples_ = 0;
+    for(int j = 0; j < n_; j++) mean_[j] = 0.;
+    for(int j = 0; j < n_ * n_; j++) scatter_[j] = 0.;
+}
+
+void CpcavPca::update(const pcavSnapshot &snap)
+{
+    for(int j = 0; j < n_; j++) x_[(size_t) j * config_.block + fill_] = field_value(snap, field_[j]);
+    if(++fill_ == config_.block) merge();
+}
+
+void CpcavPca::update(const double *x)
+{
+    for(int j = 0; j < n_; j++) x_[(size_t) j * config_.block + fill_] = x[j];
+    if(++fill_ == config_.block) merge();
+}
+
+// combine the weighted statistics of the block with the decayed running ones
+void CpcavPca::merge(void)
+{
+    const unsigned B = config_.block;
+    double w0 = blockDecay_ * weight_;
+    double w  = w0 + blockWeight_;
+    double f  = w0 * blockWeight_ / w;
+
+    // center the block on its own weighted mean and scale the rows by sqrt(weight)
+    for(int j = 0; j < n_; j++) {
+        double *xj = &x_[(size_t) j * B];
+        double  s  = 0.;
+        for(unsigned i = 0; i < B; i++) s += wsqrt_[i] * wsqrt_[i] * xj[i];
+        double mb = s / blockWeight_;
+        for(unsigned i = 0; i < B; i++) xj[i] = wsqrt_[i] * (xj[i] - mb);
+
+        double delta = mb - mean_[j];
+        mean_[j] += delta * blockWeight_ / w;
+        delta_[j] = delta;
+    }
+
+    // rank-B update of the upper triangle, lanes independent so the inner loop vectorizes
+    for(int j = 0; j < n_; j++) {
+        const double *yj = &x_[(size_t) j * B];
+        for(int k = j; k < n_; k++) {
+            const double *yk = &x_[(size_t) k * B];
+            double acc[PCAV_PCA_LANES] = { 0. };
+            for(unsigned i = 0; i < B; i += PCAV_PCA_LANES) {
+                for(int l = 0; l < PCAV_PCA_LANES; l++) acc[l] += yj[i + l] * yk[i + l];
+            }
+            double s = 0.;
+            for(int l = 0; l < PCAV_PCA_LANES; l++) s += acc[l];
+            scatter_[j * n_ + k] = blockDecay_ * scatter_[j * n_ + k] + s + f * delta_[j] * delta_[k];
+        }
+    }
+
+    weight_   = w;
+    samples_ += B;
+    fill_     = 0;
+    stats_.samples += B;
+    stats_.blocks++;
+
+    if(__atomic_load_n(&want_, __ATOMIC_ACQUIRE)) publish();
+}
+
+// hand a copy to the solver, never blocks the update thread
+void CpcavPca::publish(void)
+{
+    if(pthread_mutex_trylock(&copyLock_)) {
+        stats_.busy++;
+        return;
+    }
+    memcpy(&copyMean_[0], &mean_[0], n_ * sizeof(double));
+    memcpy(&copyScatter_[0], &scatter_[0], (size_t) n_ * n_ * sizeof(double));
+    copyWeight_  = weight_;
+    copySamples_ = samples_;
+    copyValid_   = true;
+    __atomic_store_n(&want_, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&copyLock_);
+}
+
+// covariance, or correlation, of the statistics into the solver workspace
+int CpcavPca::load(const double *mean, const double *scatter, double weight, uint64_t samples)
+{
+    if(!n_ || weight <= 0.) return -1;
+
+    work_.samples = samples;
+    work_.weight  = weight;
+    work_.fields  = n_;
+    for(int j = 0; j < n_; j++) {
+        work_.mean[j]  = mean[j];
+        work_.sigma[j] = sqrt(scatter[j * n_ + j] / weight);
+    }
+    for(int j = 0; j < n_; j++) {
+        for(int k = j; k < n_; k++) {
+            double c = scatter[j * n_ + k] / weight;
+            if(config_.correlation) c = (work_.sigma[j] > 0. && work_.sigma[k] > 0.) ? c / (work_.sigma[j] * work_.sigma[k]) : 0.;
+            a_[j * n_ + k] = a_[k * n_ + j] = c;
+        }
+    }
+
+    return 0;
+}
+
+void CpcavPca::decompose(void)
+{
+    uint64_t t0 = now_us();
+    int      sweeps = jacobi(&a_[0], &v_[0], &d_[0], n_);
+    int      k = (int) config_.components < n_ ? (int) config_.components : n_;
+    uint64_t used = 0;
+
+    work_.total = 0.;
+    for(int i = 0; i < n_; i++) work_.total += d_[i] > 0. ? d_[i] : 0.;
+    work_.components = k;
+
+    for(int c = 0; c < k; c++) {
+        int best = -1;
+        for(int i = 0; i < n_; i++) {
+            if(!(used & ((uint64_t) 1 << i)) && (best < 0 || d_[i] > d_[best])) best = i;
+        }
+        used |= (uint64_t) 1 << best;
+
+        double ev = d_[best] > 0. ? d_[best] : 0.;
+        int    big = 0;
+        for(int j = 1; j < n_; j++) if(fabs(v_[j * n_ + best]) > fabs(v_[big * n_ + best])) big = j;
+        double sign = v_[big * n_ + best] < 0. ? -1. : 1.;
+
+        work_.eigenvalue[c] = ev;
+        work_.explained[c]  = work_.total > 0. ? ev / work_.total : 0.;
+        for(int j = 0; j < n_; j++) {
+            work_.vector[c][j]  = sign * v_[j * n_ + best];
+            work_.loading[c][j] = work_.vector[c][j] * sqrt(ev);
+        }
+    }
+
+    pthread_mutex_lock(&resultLock_);
+    result_      = work_;
+    resultValid_ = true;
+    solves_++;
+    sweeps_      = sweeps;
+    solveUs_     = now_us() - t0;
+    pthread_mutex_unlock(&resultLock_);
+}
+
+void CpcavPca::solveNow(void)
+{
+    if(!load(&mean_[0], &scatter_[0], weight_, samples_)) decompose();
+}
+
+void *CpcavPca::task(void *arg)
+{
+    CpcavPca *p = (CpcavPca *) arg;
+    uint64_t  period = (uint64_t) p->config_.intervalMs * 1000;
+    uint64_t  next = now_us() + period;
+
+    if(p->hasProfile_) pcavRtApply(p->profile_);
+
+    while(p->run_) {
+        uint64_t now = now_us();
+        if(now < next) {
+            sleep_us(next - now < 100000 ? next - now : 100000);    // stay responsive to stop()
+            continue;
+        }
+        next = now + period;
+
+        // the copy is taken by the update thread at its next block merge
+        int ok;
+        pthread_mutex_lock(&p->copyLock_);
+        ok = p->copyValid_ ? p->load(&p->copyMean_[0], &p->copyScatter_[0], p->copyWeight_, p->copySamples_) : -1;
+        p->copyValid_ = false;
+        __atomic_store_n(&p->want_, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&p->copyLock_);
+
+        if(!ok) p->decompose();
+    }
+
+    return 0;
+}
+
+int CpcavPca::start(const pcavRtProfile *profile)
+{
+    if(run_ || !n_) return -1;
+
+    hasProfile_ = profile != 0;
+    if(profile) profile_ = *profile;
+
+    want_ = 1;
+    run_  = true;
+    int err = pthread_create(&thread_, 0, task, this);
+    if(err) {
+        fprintf(stderr, "CpcavPca: thread create failed (%s)\n", strerror(err));
+        run_ = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void CpcavPca::stop(void)
+{
+    if(!run_) return;
+
+    run_ = false;
+    pthread_join(thread_, 0);
+}
+
+int CpcavPca::getResult(pcavPcaResult *result)
+{
+    int status = -1;
+
+    pthread_mutex_lock(&resultLock_);
+    if(resultValid_) {
+        *result = result_;
+        status  = 0;
+    }
+    pthread_mutex_unlock(&resultLock_);
+
+    return status;
+}
+
+void CpcavPca::getStats(pcavPcaStats *stats)
+{
+    *stats = stats_;
+
+    pthread_mutex_lock(&resultLock_);
+    stats->solves  = solves_;
+    stats->sweeps  = sweeps_;
+    stats->solveUs = solveUs_;
+    pthread_mutex_unlock(&resultLock_);
+}
+
+void CpcavPca::clearStats(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+
+    pthread_mutex_lock(&resultLock_);
+    solves_  = 0;
+    sweeps_  = 0;
+    solveUs_ = 0;
+    pthread_mutex_unlock(&resultLock_);
+}
@@ -0,0 +1,142 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVPCA_H
+#define _PCAVPCA_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+#include "pcavFw.h"
+#include "pcavRecord.h"
+#include "pcavRt.h"
+
+#define PCAV_PCA_MAX_FIELDS      PCAV_REC_FIELDS
+#define PCAV_PCA_MAX_COMPONENTS  8
+#define PCAV_PCA_LANES           4         // block length is rounded up to a multiple
+
+// streaming covariance over a set of fields, selected by pcavRecField() index
+// the acquisition thread adds one snapshot per pulse, samples are merged a block at a time
+// with exponential forgetting, the weight of a sample decays by forget per later sample
+// a background thread eigen-decomposes a copy of the covariance at a fixed interval
+// phases are taken as they are, fields close to the +/-180 degree wrap are not meaningful
+struct pcavPcaConfig {
+    double    forget;          // per sample, effective length 1 / (1 - forget) samples
+    unsigned  block;           // samples per merge
+    unsigned  components;      // principal components reported, up to PCAV_PCA_MAX_COMPONENTS
+    unsigned  intervalMs;      // background solve period
+    bool      correlation;     // decompose the correlation instead of the covariance matrix
+
+    pcavPcaConfig(): forget(0.999), block(16), components(4), intervalMs(1000), correlation(true) {}
+};
+
+struct pcavPcaResult {
+    uint64_t  samples;         // merged into the solved matrix
+    double    weight;          // sum of the decayed sample weights
+    int       fields;
+    int       components;
+    double    total;           // trace, total variance
+    double    mean[PCAV_PCA_MAX_FIELDS];
+    double    sigma[PCAV_PCA_MAX_FIELDS];
+    double    eigenvalue[PCAV_PCA_MAX_COMPONENTS];                    // descending
+    double    explained[PCAV_PCA_MAX_COMPONENTS];                     // eigenvalue / total
+    double    vector[PCAV_PCA_MAX_COMPONENTS][PCAV_PCA_MAX_FIELDS];   // unit length, largest element positive
+    double    loading[PCAV_PCA_MAX_COMPONENTS][PCAV_PCA_MAX_FIELDS];  // vector * sqrt(eigenvalue), the correlation of
+                                                                      // the field with the component in correlation mode
+};
+
+struct pcavPcaStats {
+    uint64_t  samples;
+    uint64_t  blocks;
+    uint64_t  solves;
+    uint64_t  busy;            // copies skipped because the solver held the matrix
+    uint64_t  sweeps;          // Jacobi sweeps of the last solve
+    uint64_t  solveUs;         // duration of the last solve
+};
+
+class CpcavPca {
+private:
+    int       n_;
+    int       field_[PCAV_PCA_MAX_FIELDS];
+    pcavPcaConfig config_;
+
+    // accumulator, owned by the update thread
+    std::vector<double> x_;         // current block, field major, n x block
+    std::vector<double> wsqrt_;     // sqrt of the weight of each block position
+    double    blockWeight_;
+    double    blockDecay_;          // forget ^ block
+    unsigned  fill_;
+    double    weight_;
+    std::vector<double> mean_;
+    std::vector<double> delta_;     // block mean - running mean
+    std::vector<double> scatter_;   // n x n, upper triangle, weighted sum of centered outer products
+    uint64_t  samples_;
+
+    // copy handed to the solver
+    pthread_mutex_t copyLock_;
+    int       want_;           // solver asks for a copy, __atomic between the threads
+    std::vector<double> copyMean_;
+    std::vector<double> copyScatter_;
+    double    copyWeight_;
+    uint64_t  copySamples_;
+    bool      copyValid_;
+
+    // solver workspace and published result
+    std::vector<double> a_;
+    std::vector<double> v_;
+    std::vector<double> d_;
+    pcavPcaResult work_;
+    pthread_mutex_t resultLock_;
+    pcavPcaResult result_;
+    bool      resultValid_;
+    uint64_t  solves_;         // solver counters, under resultLock_ with the result
+    uint64_t  sweeps_;
+    uint64_t  solveUs_;
+
+    volatile bool run_;
+    pthread_t thread_;
+    pcavRtProfile profile_;
+    bool      hasProfile_;
+
+    pcavPcaStats stats_;       // update thread counters, the solver fields are filled in by getStats()
+
+    void      merge(void);
+    void      publish(void);
+    int       load(const double *mean, const double *scatter, double weight, uint64_t samples);
+    void      decompose(void);
+    static void *task(void *arg);
+
+public:
+    // fields is a list of pcavRecField() indices, invalid ones are dropped
+    CpcavPca(const int *fields, int nFields, const pcavPcaConfig &config = pcavPcaConfig());
+    ~CpcavPca();
+
+    int       fields(void) const { return n_; }
+    int       field(int i) const { return field_[i]; }
+
+    // update thread, one sample per pulse
+    void      update(const pcavSnapshot &snap);
+    void      update(const double *x);     // fields() values in field order
+    void      reset(void);                  // not while the background thread runs
+
+    // background solve, with the profile applied to the thread when given
+    int       start(const pcavRtProfile *profile = 0);
+    void      stop(void);
+
+    // synchronous solve from the update thread, when the background thread does not run
+    void      solveNow(void);
+
+    // latest result, -1 if nothing was solved yet
+    int       getResult(pcavPcaResult *result);
+
+    void      getStats(pcavPcaStats *stats);
+    void      clearStats(void);
+};
+
+#endif /* _PCAVPCA_H */
@@ -0,0 +1,217 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavPoll.h"
+
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+
+
+static int default_tier(int field)
+{
+    switch(field) {
+        case PCAV_OUT_PHASE:
+        case PCAV_COMP_PHASE:
+        case PCAV_INTEG_I:
+        case PCAV_INTEG_Q:
+            return 0;
+        case PCAV_DC_FREQ:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+
+CpcavPollScheduler::CpcavPollScheduler(pcavFw fw, unsigned budget):
+    fw_(fw), budget_(budget),
+    start_(PCAV_POLL_MAX_TIERS), first_(PCAV_POLL_MAX_TIERS + 1),
+    cycle_(0), planned_(false)
+{
+    item it;
+
+    period_[0] = 1;
+    period_[1] = 10;
+    period_[2] = 100;
+    period_[3] = PCAV_POLL_ONCE;
+
+    memset(&it, 0, sizeof(it));
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            for(int f = 0; f < PCAV_NUM_PROBE_FIELDS; f++) {
+                it.kind = PROBE; it.cavity = c; it.probe = p; it.field = f; it.tier = default_tier(f);
+                items_.push_back(it);
+            }
+            it.kind = PHASE_OFFSET; it.field = 0; it.tier = 2;
+            items_.push_back(it);
+            it.kind = WEIGHT;
+            items_.push_back(it);
+        }
+    }
+    for(int f = 0; f < PCAV_NUM_REF_FIELDS; f++) {
+        it.kind = REF; it.cavity = 0; it.probe = 0; it.field = f; it.tier = 2;
+        items_.push_back(it);
+    }
+    it.kind = VERSION; it.field = 0; it.tier = 3;
+    items_.push_back(it);
+
+    clearStats();
+}
+
+void CpcavPollScheduler::setPeriod(int tier, unsigned period)
+{
+    if(tier < 0 || tier >= PCAV_POLL_MAX_TIERS) return;
+    period_[tier] = period;
+    planned_ = false;
+}
+
+void CpcavPollScheduler::setTier(pcavProbeField field, int tier)
+{
+    if(tier < 0 || tier >= PCAV_POLL_MAX_TIERS) return;
+    for(size_t i = 0; i < items_.size(); i++) {
+        if(items_[i].kind == PROBE && items_[i].field == field) items_[i].tier = tier;
+    }
+    planned_ = false;
+}
+
+void CpcavPollScheduler::setTier(pcavRefField field, int tier)
+{
+    if(tier < 0 || tier >= PCAV_POLL_MAX_TIERS) return;
+    for(size_t i = 0; i < items_.size(); i++) {
+        if(items_[i].kind == REF && items_[i].field == field) items_[i].tier = tier;
+    }
+    planned_ = false;
+}
+
+void CpcavPollScheduler::setSettingsTier(int tier)
+{
+    if(tier < 0 || tier >= PCAV_POLL_MAX_TIERS) return;
+    for(size_t i = 0; i < items_.size(); i++) {
+        if(items_[i].kind == PHASE_OFFSET || items_[i].kind == WEIGHT) items_[i].tier = tier;
+    }
+    planned_ = false;
+}
+
+void CpcavPollScheduler::restart(void)
+{
+    planned_ = false;
+}
+
+// group the items by tier and give the k-th item of a tier the phase k % period,
+// so each cycle carries the same share of every slow tier
+void CpcavPollScheduler::plan(void)
+{
+    std::stable_sort(items_.begin(), items_.end(),
+                     [](const item &a, const item &b) { return a.tier < b.tier; });
+
+    size_t i = 0;
+    for(int t = 0; t < PCAV_POLL_MAX_TIERS; t++) {
+        first_[t] = i;
+        start_[t] = 0;
+        for(size_t k = 0; i < items_.size() && items_[i].tier == t; i++, k++) {
+            items_[i].late = false;
+            items_[i].due  = cycle_ + (period_[t] == PCAV_POLL_ONCE ? 0 : k % period_[t]);
+        }
+    }
+    first_[PCAV_POLL_MAX_TIERS] = i;
+
+    planned_ = true;
+}
+
+double CpcavPollScheduler::load(void)
+{
+    double l = 0.;
+
+    if(!planned_) plan();
+    for(int t = 0; t < PCAV_POLL_MAX_TIERS; t++) {
+        if(period_[t] != PCAV_POLL_ONCE) l += (double) (first_[t + 1] - first_[t]) / period_[t];
+    }
+
+    return l;
+}
+
+void CpcavPollScheduler::read(item &it, pcavPollState *state)
+{
+    int32_t raw;
+
+    switch(it.kind) {
+        case PROBE:
+            state->snap.val[it.cavity][it.probe][it.field] =
+                fw_->getProbeField(it.cavity, it.probe, (pcavProbeField) it.field, &state->snap.raw[it.cavity][it.probe][it.field]);
+            break;
+        case REF:
+            state->snap.ref[it.field] = fw_->getRefField((pcavRefField) it.field, &state->snap.refRaw[it.field]);
+            break;
+        case PHASE_OFFSET:
+            state->phaseOffset[it.cavity][it.probe] = fw_->getPhaseOffset(it.cavity, it.probe, &raw);
+            break;
+        case WEIGHT:
+            state->weight[it.cavity][it.probe] = fw_->getWeight(it.cavity, it.probe, &raw);
+            break;
+        case VERSION:
+            fw_->getVersion(&state->version);
+            break;
+    }
+}
+
+unsigned CpcavPollScheduler::cycle(pcavPollState *state)
+{
+    unsigned n = 0;
+
+    if(!planned_) plan();
+    clock_gettime(CLOCK_REALTIME, &state->snap.ts);
+
+    // tiers in priority order, within a tier round robin from the first item deferred last cycle
+    for(int t = 0; t < PCAV_POLL_MAX_TIERS; t++) {
+        size_t b   = first_[t];
+        size_t cnt = first_[t + 1] - b;
+        size_t next = cnt;
+
+        for(size_t j = 0; j < cnt; j++) {
+            size_t k = (start_[t] + j) % cnt;
+            item &it = items_[b + k];
+
+            if(it.due > cycle_) continue;
+            if(budget_ && n >= budget_) {
+                stats_.deferred++;
+                if(!it.late) {
+                    it.late = true;
+                    stats_.misses[t]++;
+                }
+                if(next == cnt) next = k;
+                continue;
+            }
+
+            read(it, state);
+            n++;
+            it.late = false;
+            if(period_[t] == PCAV_POLL_ONCE) it.due = UINT64_MAX;
+            else while(it.due <= cycle_) it.due += period_[t];    // keep the phase after a deferral
+        }
+        if(next != cnt) start_[t] = next;
+    }
+
+    cycle_++;
+    stats_.cycles++;
+    stats_.reads += n;
+    if(n > stats_.maxReads) stats_.maxReads = n;
+
+    return n;
+}
+
+void CpcavPollScheduler::getStats(pcavPollStats *stats)
+{
+    *stats = stats_;
+}
+
+void CpcavPollScheduler::clearStats(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVPOLL_H
+#define _PCAVPOLL_H
+
+#include <stdint.h>
+#include <vector>
+#include "pcavFw.h"
+
+// rate tiers of the poll scheduler, the period is in poll cycles
+#define PCAV_POLL_MAX_TIERS  4
+#define PCAV_POLL_ONCE       0    // period: read on the first cycle only
+
+// default assignment
+//   tier 0, every cycle:      OutPhase, CompPhase, IntegI, IntegQ
+//   tier 1, every 10 cycles:  IF, DC real/imaginary, OutAmpl
+//   tier 2, every 100 cycles: DCFreq, RF reference, PhaseOffset and Weight readback
+//   tier 3, once:             firmware version
+
+// latest value of every scheduled field
+struct pcavPollState {
+    pcavSnapshot snap;         // probe and reference fields, ts is the time of the last cycle
+    double    phaseOffset[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    weight[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    int32_t   version;
+};
+
+struct pcavPollStats {
+    uint64_t  cycles;
+    uint64_t  reads;
+    uint64_t  maxReads;                        // most reads in one cycle
+    uint64_t  deferred;                        // due reads pushed to a later cycle by the budget
+    uint64_t  misses[PCAV_POLL_MAX_TIERS];     // reads which became due and were not done in that cycle
+};
+
+class CpcavPollScheduler {
+private:
+    enum kind { PROBE, REF, PHASE_OFFSET, WEIGHT, VERSION };
+    struct item {
+        uint8_t   kind;
+        uint8_t   cavity;
+        uint8_t   probe;
+        uint8_t   field;
+        uint8_t   tier;
+        bool      late;        // due and deferred, the miss is counted
+        uint64_t  due;         // cycle of the next read
+    };
+
+    pcavFw    fw_;
+    unsigned  budget_;
+    unsigned  period_[PCAV_POLL_MAX_TIERS];
+    std::vector<item> items_;
+    std::vector<size_t> start_;    // per tier round robin start, items_ is sorted by tier
+    std::vector<size_t> first_;    // per tier first index in items_, PCAV_POLL_MAX_TIERS + 1 entries
+    uint64_t  cycle_;
+    bool      planned_;
+    pcavPollStats stats_;
+
+    void      plan(void);
+    void      read(item &it, pcavPollState *state);
+
+public:
+    // budget: register reads per cycle, 0 for no limit
+    CpcavPollScheduler(pcavFw fw, unsigned budget);
+
+    void      setBudget(unsigned budget) { budget_ = budget; }
+    void      setPeriod(int tier, unsigned period);    // cycles, PCAV_POLL_ONCE
+    void      setTier(pcavProbeField field, int tier); // all cavities and probes
+    void      setTier(pcavRefField field, int tier);
+    void      setSettingsTier(int tier);               // PhaseOffset and Weight readback
+
+    // transactions per cycle averaged over the longest period, the budget needed for no misses
+    double    load(void);
+
+    // one poll cycle, reads the due fields within the budget into state, returns the number of reads
+    unsigned  cycle(pcavPollState *state);
+
+    void      restart(void);    // everything due again on the next cycle
+    void      getStats(pcavPollStats *stats);
+    void      clearStats(void);
+};
+
+#endif /* _PCAVPOLL_H */
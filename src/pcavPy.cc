@@ -0,0 +1,848 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+// Python extension module "pcav"
+//
+//   import pcav, numpy as np
+//   fw   = pcav.Fw("000TopLevel.yaml", "mmio/AppTop/AppCore/Pcav")
+//   hist = pcav.History(1024)
+//   fw.snapshot(hist)                                   # read into the next history slot
+//   phase = np.asarray(hist.field(0, 0, pcav.OUT_PHASE))  # zero-copy, slot order, see hist.head
+//
+// Arrays are exported through the buffer protocol and alias the library buffers,
+// numpy wraps them without a copy. A view keeps its owner alive, the content changes
+// with the next snapshot written into the owner.
+//
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include "pcavFw.h"
+#include "dacSigGenFw.h"
+#include "pcavHistory.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+
+#define PCAVPY_MAX_DIM  3
+
+// generic strided view on memory owned by another python object
+typedef struct {
+    PyObject_HEAD
+    PyObject   *owner;
+    char       *buf;
+    const char *format;
+    Py_ssize_t  itemsize;
+    int         ndim;
+    Py_ssize_t  shape[PCAVPY_MAX_DIM];
+    Py_ssize_t  strides[PCAVPY_MAX_DIM];
+} pcavPyView;
+
+typedef struct {
+    PyObject_HEAD
+    pcavSnapshot  snap;
+} pcavPySnapshot;
+
+typedef struct {
+    PyObject_HEAD
+    CpcavHistory *hist;
+} pcavPyHistory;
+
+typedef struct {
+    PyObject_HEAD
+    pcavFw        fw;
+} pcavPyFw;
+
+typedef struct {
+    PyObject_HEAD
+    dacSigGenFw   dac;
+} pcavPyDac;
+
+// slots are filled in PyInit_pcav()
+static PyTypeObject pcavPyViewType     = { PyVarObject_HEAD_INIT(0, 0) "pcav.View" };
+static PyTypeObject pcavPySnapshotType = { PyVarObject_HEAD_INIT(0, 0) "pcav.Snapshot" };
+static PyTypeObject pcavPyHistoryType  = { PyVarObject_HEAD_INIT(0, 0) "pcav.History" };
+static PyTypeObject pcavPyFwType       = { PyVarObject_HEAD_INIT(0, 0) "pcav.Fw" };
+static PyTypeObject pcavPyDacType      = { PyVarObject_HEAD_INIT(0, 0) "pcav.DacSigGen" };
+
+
+// bus access with the GIL released, CPSWError is turned into RuntimeError by pcavPyError()
+#define PCAVPY_CALL(expr)                               \
+    Py_BEGIN_ALLOW_THREADS                              \
+    try {                                               \
+        expr;                                           \
+    } catch(CPSWError &e) {                             \
+        err    = e.getInfo();                           \
+        failed = true;                                  \
+    }                                                   \
+    Py_END_ALLOW_THREADS
+
+static PyObject *pcavPyError(const std::string &err)
+{
+    PyErr_SetString(PyExc_RuntimeError, err.c_str());
+
+    return 0;
+}
+
+
+static PyObject *view_new(PyObject *owner, void *buf, const char *format, Py_ssize_t itemsize,
+                          int ndim, const Py_ssize_t *shape, const Py_ssize_t *strides)
+{
+    pcavPyView *v = PyObject_New(pcavPyView, &pcavPyViewType);
+
+    if(!v) return 0;
+    Py_INCREF(owner);
+    v->owner    = owner;
+    v->buf      = (char *) buf;
+    v->format   = format;
+    v->itemsize = itemsize;
+    v->ndim     = ndim;
+    for(int i = 0; i < ndim; i++) {
+        v->shape[i]   = shape[i];
+        v->strides[i] = strides[i];
+    }
+
+    return (PyObject *) v;
+}
+
+static void view_dealloc(pcavPyView *self)
+{
+    Py_XDECREF(self->owner);
+    PyObject_Del(self);
+}
+
+static int view_getbuffer(pcavPyView *self, Py_buffer *view, int flags)
+{
+    bool contiguous = true;
+    Py_ssize_t len  = self->itemsize;
+
+    for(int i = self->ndim - 1; i >= 0; i--) {
+        if(self->strides[i] != len) contiguous = false;
+        len *= self->shape[i];
+    }
+    if(!contiguous && (flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+        PyErr_SetString(PyExc_BufferError, "pcav view is strided");
+        return -1;
+    }
+    if((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "pcav view is read-only");
+        return -1;
+    }
+
+    view->obj        = (PyObject *) self;
+    view->buf        = self->buf;
+    view->len        = len;
+    view->readonly   = 1;
+    view->itemsize   = self->itemsize;
+    view->format     = (flags & PyBUF_FORMAT) ? (char *) self->format : 0;
+    view->ndim       = self->ndim;
+    view->shape      = (flags & PyBUF_ND) ? self->shape : 0;
+    view->strides    = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : 0;
+    view->suboffsets = 0;
+    view->internal   = 0;
+    Py_INCREF(self);
+
+    return 0;
+}
+
+static PyBufferProcs view_as_buffer = { (getbufferproc) view_getbuffer, 0 };
+
+
+//
+// Snapshot, the buffer is val[cavity][probe][field], raw and ref are views
+//
+
+static PyObject *snapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcavPySnapshot *self = (pcavPySnapshot *) type->tp_alloc(type, 0);
+
+    if(self) memset(&self->snap, 0, sizeof(self->snap));
+
+    return (PyObject *) self;
+}
+
+static int snapshot_getbuffer(pcavPySnapshot *self, Py_buffer *view, int flags)
+{
+    static Py_ssize_t shape[3] = { PCAV_NUM_CAVITY, PCAV_NUM_PROBE, PCAV_NUM_PROBE_FIELDS };
+    static Py_ssize_t strides[3] = { sizeof(self->snap.val[0]), sizeof(self->snap.val[0][0]), sizeof(double) };
+
+    view->obj        = (PyObject *) self;
+    view->buf        = self->snap.val;
+    view->len        = sizeof(self->snap.val);
+    view->readonly   = 1;
+    view->itemsize   = sizeof(double);
+    view->format     = (flags & PyBUF_FORMAT) ? (char *) "d" : 0;
+    view->ndim       = 3;
+    view->shape      = (flags & PyBUF_ND) ? shape : 0;
+    view->strides    = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? strides : 0;
+    view->suboffsets = 0;
+    view->internal   = 0;
+    if((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "pcav snapshot is read-only");
+        view->obj = 0;
+        return -1;
+    }
+    Py_INCREF(self);
+
+    return 0;
+}
+
+static PyBufferProcs snapshot_as_buffer = { (getbufferproc) snapshot_getbuffer, 0 };
+
+static PyObject *snapshot_raw(pcavPySnapshot *self, void *closure)
+{
+    Py_ssize_t shape[3]   = { PCAV_NUM_CAVITY, PCAV_NUM_PROBE, PCAV_NUM_PROBE_FIELDS };
+    Py_ssize_t strides[3] = { sizeof(self->snap.raw[0]), sizeof(self->snap.raw[0][0]), sizeof(int32_t) };
+
+    return view_new((PyObject *) self, self->snap.raw, "i", sizeof(int32_t), 3, shape, strides);
+}
+
+static PyObject *snapshot_ref(pcavPySnapshot *self, void *closure)
+{
+    Py_ssize_t shape   = PCAV_NUM_REF_FIELDS;
+    Py_ssize_t strides = sizeof(double);
+
+    return view_new((PyObject *) self, self->snap.ref, "d", sizeof(double), 1, &shape, &strides);
+}
+
+static PyObject *snapshot_ref_raw(pcavPySnapshot *self, void *closure)
+{
+    Py_ssize_t shape   = PCAV_NUM_REF_FIELDS;
+    Py_ssize_t strides = sizeof(int32_t);
+
+    return view_new((PyObject *) self, self->snap.refRaw, "i", sizeof(int32_t), 1, &shape, &strides);
+}
+
+static PyObject *snapshot_time(pcavPySnapshot *self, void *closure)
+{
+    return PyFloat_FromDouble(self->snap.ts.tv_sec + 1.E-9 * self->snap.ts.tv_nsec);
+}
+
+static PyMemberDef snapshot_members[] = {
+    { (char *) "pulse_id", T_ULONGLONG, offsetof(pcavPySnapshot, snap) + offsetof(pcavSnapshot, pulseId), READONLY, 0 },
+    { (char *) "flags",    T_UINT,      offsetof(pcavPySnapshot, snap) + offsetof(pcavSnapshot, flags),   READONLY, 0 },
+    { (char *) "retries",  T_UINT,      offsetof(pcavPySnapshot, snap) + offsetof(pcavSnapshot, retries), READONLY, 0 },
+    { 0 }
+};
+
+static PyGetSetDef snapshot_getset[] = {
+    { (char *) "raw",     (getter) snapshot_raw,     0, (char *) "raw register words [cavity][probe][field]", 0 },
+    { (char *) "ref",     (getter) snapshot_ref,     0, (char *) "RF reference [field]", 0 },
+    { (char *) "ref_raw", (getter) snapshot_ref_raw, 0, (char *) "RF reference raw words [field]", 0 },
+    { (char *) "time",    (getter) snapshot_time,    0, (char *) "acquisition time, seconds", 0 },
+    { 0 }
+};
+
+
+//
+// History, views are in slot order, the newest snapshot is in slot (head - 1) % capacity
+//
+
+static int history_init(pcavPyHistory *self, PyObject *args, PyObject *kwds)
+{
+    Py_ssize_t depth;
+
+    if(!PyArg_ParseTuple(args, "n", &depth)) return -1;
+    if(depth <= 0) {
+        PyErr_SetString(PyExc_ValueError, "depth must be positive");
+        return -1;
+    }
+    // views returned by field() and pulse_id() point into the ring, it lives as long as the object
+    if(self->hist) {
+        PyErr_SetString(PyExc_RuntimeError, "History is already initialised");
+        return -1;
+    }
+    self->hist = new CpcavHistory((size_t) depth);
+
+    return 0;
+}
+
+static void history_dealloc(pcavPyHistory *self)
+{
+    delete self->hist;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *history_field(pcavPyHistory *self, PyObject *args)
+{
+    int cavity, probe, field, raw = 0;
+
+    if(!PyArg_ParseTuple(args, "iii|p", &cavity, &probe, &field, &raw)) return 0;
+    if(cavity < 0 || cavity >= PCAV_NUM_CAVITY || probe < 0 || probe >= PCAV_NUM_PROBE ||
+       field < 0 || field >= PCAV_NUM_PROBE_FIELDS) {
+        PyErr_SetString(PyExc_IndexError, "cavity, probe or field out of range");
+        return 0;
+    }
+
+    const pcavSnapshot *ring = self->hist->ring();
+    Py_ssize_t shape   = self->hist->capacity();
+    Py_ssize_t strides = sizeof(pcavSnapshot);
+
+    if(raw) return view_new((PyObject *) self, (void *) &ring->raw[cavity][probe][field], "i", sizeof(int32_t), 1, &shape, &strides);
+
+    return view_new((PyObject *) self, (void *) &ring->val[cavity][probe][field], "d", sizeof(double), 1, &shape, &strides);
+}
+
+static PyObject *history_pulse_id(pcavPyHistory *self, PyObject *args)
+{
+    Py_ssize_t shape   = self->hist->capacity();
+    Py_ssize_t strides = sizeof(pcavSnapshot);
+
+    return view_new((PyObject *) self, (void *) &self->hist->ring()->pulseId, "Q", sizeof(uint64_t), 1, &shape, &strides);
+}
+
+static PyObject *history_clear(pcavPyHistory *self, PyObject *args)
+{
+    self->hist->clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject *history_head(pcavPyHistory *self, void *closure)     { return PyLong_FromSize_t(self->hist->head()); }
+static PyObject *history_capacity(pcavPyHistory *self, void *closure) { return PyLong_FromSize_t(self->hist->capacity()); }
+static PyObject *history_overruns(pcavPyHistory *self, void *closure) { return PyLong_FromUnsignedLongLong(self->hist->overruns()); }
+static Py_ssize_t history_len(pcavPyHistory *self)                    { return self->hist->size(); }
+
+static PyMethodDef history_methods[] = {
+    { "field",    (PyCFunction) history_field,    METH_VARARGS, "field(cavity, probe, field, raw=False), strided view over all slots" },
+    { "pulse_id", (PyCFunction) history_pulse_id, METH_NOARGS,  "pulse ID view over all slots" },
+    { "clear",    (PyCFunction) history_clear,    METH_NOARGS,  "drop all snapshots" },
+    { 0 }
+};
+
+static PyGetSetDef history_getset[] = {
+    { (char *) "head",     (getter) history_head,     0, (char *) "next slot to write", 0 },
+    { (char *) "capacity", (getter) history_capacity, 0, (char *) "number of slots", 0 },
+    { (char *) "overruns", (getter) history_overruns, 0, (char *) "snapshots dropped since clear()", 0 },
+    { 0 }
+};
+
+static PySequenceMethods history_as_sequence = { (lenfunc) history_len };
+
+
+//
+// Fw
+//
+
+static int fw_init(pcavPyFw *self, PyObject *args, PyObject *kwds)
+{
+    static const char *kwlist[] = { "yaml", "path", "root", 0 };
+    const char *yaml, *path, *root = "NetIODev";
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "ss|s", (char **) kwlist, &yaml, &path, &root)) return -1;
+
+    try {
+        Path p = IPath::loadYamlFile(yaml, root);
+        self->fw = IpcavFw::create(p->findByName(path));
+    } catch(CPSWError &e) {
+        PyErr_SetString(PyExc_RuntimeError, e.getInfo().c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+static PyObject *fw_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcavPyFw *self = (pcavPyFw *) type->tp_alloc(type, 0);
+
+    if(self) new (&self->fw) pcavFw();
+
+    return (PyObject *) self;
+}
+
+static void fw_dealloc(pcavPyFw *self)
+{
+    self->fw.~pcavFw();
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+// fw.snapshot(target, coherent=0), target is a Snapshot or a History, coherent is the retry count
+static PyObject *fw_snapshot(pcavPyFw *self, PyObject *args, PyObject *kwds)
+{
+    std::string err;
+    bool failed = false;
+    static const char *kwlist[] = { "target", "coherent", 0 };
+    PyObject *target;
+    int coherent = 0;
+    bool ok = true;
+    pcavSnapshot *snap;
+    CpcavHistory *hist = 0;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", (char **) kwlist, &target, &coherent)) return 0;
+
+    if(PyObject_TypeCheck(target, &pcavPySnapshotType)) snap = &((pcavPySnapshot *) target)->snap;
+    else if(PyObject_TypeCheck(target, &pcavPyHistoryType)) {
+        hist = ((pcavPyHistory *) target)->hist;
+        snap = hist->next();
+    }
+    else {
+        PyErr_SetString(PyExc_TypeError, "target must be a pcav.Snapshot or a pcav.History");
+        return 0;
+    }
+
+    PCAVPY_CALL(if(coherent > 0) ok = self->fw->getSnapshotCoherent(snap, coherent);
+                else self->fw->getSnapshot(snap))
+    if(failed) return pcavPyError(err);
+
+    if(hist) hist->push();
+
+    return PyBool_FromLong(ok);
+}
+
+static PyObject *fw_set_nco(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    int cavity;
+    double v;
+    uint32_t word = 0;
+
+    if(!PyArg_ParseTuple(args, "id", &cavity, &v)) return 0;
+
+    PCAVPY_CALL(word = self->fw->setNCO(cavity, v))
+    if(failed) return pcavPyError(err);
+
+    return PyLong_FromUnsignedLong(word);
+}
+
+// setter for (cavity, probe, value), returns the register word
+static PyObject *fw_set_probe(pcavPyFw *self, PyObject *args, uint32_t (IpcavFw::*set)(int, int, double))
+{
+    std::string err;
+    bool failed = false;
+    int cavity, probe;
+    double v;
+    uint32_t word = 0;
+
+    if(!PyArg_ParseTuple(args, "iid", &cavity, &probe, &v)) return 0;
+
+    PCAVPY_CALL(word = ((*self->fw).*set)(cavity, probe, v))
+    if(failed) return pcavPyError(err);
+
+    return PyLong_FromUnsignedLong(word);
+}
+
+static PyObject *fw_set_calib_coeff(pcavPyFw *self, PyObject *args)  { return fw_set_probe(self, args, &IpcavFw::setCalibCoeff); }
+static PyObject *fw_set_weight(pcavPyFw *self, PyObject *args)       { return fw_set_probe(self, args, &IpcavFw::setWeight); }
+
+// degrees, as get_phase_offset() returns, setPhaseOffset() takes half turns
+static PyObject *fw_set_phase_offset(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    int cavity, probe;
+    double v;
+    uint32_t word = 0;
+
+    if(!PyArg_ParseTuple(args, "iid", &cavity, &probe, &v)) return 0;
+
+    PCAVPY_CALL(word = self->fw->setPhaseOffset(cavity, probe, v / 180.))
+    if(failed) return pcavPyError(err);
+
+    return PyLong_FromUnsignedLong(word);
+}
+
+// register write for (cavity, probe, word)
+static PyObject *fw_set_probe_word(pcavPyFw *self, PyObject *args, void (IpcavFw::*set)(int, int, uint32_t))
+{
+    std::string err;
+    bool failed = false;
+    int cavity, probe;
+    unsigned int word;
+
+    if(!PyArg_ParseTuple(args, "iiI", &cavity, &probe, &word)) return 0;
+
+    PCAVPY_CALL(((*self->fw).*set)(cavity, probe, word))
+    if(failed) return pcavPyError(err);
+
+    Py_RETURN_NONE;
+}
+
+// register write for (cavity or index, word)
+static PyObject *fw_set_word(pcavPyFw *self, PyObject *args, void (IpcavFw::*set)(int, uint32_t))
+{
+    std::string err;
+    bool failed = false;
+    int index;
+    unsigned int word;
+
+    if(!PyArg_ParseTuple(args, "iI", &index, &word)) return 0;
+
+    PCAVPY_CALL(((*self->fw).*set)(index, word))
+    if(failed) return pcavPyError(err);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *fw_set_chan_sel(pcavPyFw *self, PyObject *args)           { return fw_set_probe_word(self, args, &IpcavFw::setChanSel); }
+static PyObject *fw_set_window_start(pcavPyFw *self, PyObject *args)       { return fw_set_probe_word(self, args, &IpcavFw::setWindowStart); }
+static PyObject *fw_set_window_end(pcavPyFw *self, PyObject *args)         { return fw_set_probe_word(self, args, &IpcavFw::setWindowEnd); }
+static PyObject *fw_set_phase_offset_raw(pcavPyFw *self, PyObject *args)   { return fw_set_probe_word(self, args, &IpcavFw::setPhaseOffsetRaw); }
+static PyObject *fw_set_calib_coeff_raw(pcavPyFw *self, PyObject *args)    { return fw_set_probe_word(self, args, &IpcavFw::setCalibCoeffRaw); }
+static PyObject *fw_set_weight_raw(pcavPyFw *self, PyObject *args)         { return fw_set_probe_word(self, args, &IpcavFw::setWeightRaw); }
+static PyObject *fw_set_freq_eval_start(pcavPyFw *self, PyObject *args)    { return fw_set_word(self, args, &IpcavFw::setFreqEvalStart); }
+static PyObject *fw_set_freq_eval_end(pcavPyFw *self, PyObject *args)      { return fw_set_word(self, args, &IpcavFw::setFreqEvalEnd); }
+static PyObject *fw_set_reg_latch_point(pcavPyFw *self, PyObject *args)    { return fw_set_word(self, args, &IpcavFw::setRegLatchPoint); }
+static PyObject *fw_set_nco_raw(pcavPyFw *self, PyObject *args)            { return fw_set_word(self, args, &IpcavFw::setNCORaw); }
+static PyObject *fw_set_wf_data_sel(pcavPyFw *self, PyObject *args)        { return fw_set_word(self, args, &IpcavFw::setWfDataSel); }
+
+static PyObject *fw_set_ref_sel(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    unsigned int channel;
+
+    if(!PyArg_ParseTuple(args, "I", &channel)) return 0;
+
+    PCAVPY_CALL(self->fw->setRefSel(channel))
+    if(failed) return pcavPyError(err);
+
+    Py_RETURN_NONE;
+}
+
+// getter for (cavity, probe), returns (value, raw)
+static PyObject *fw_get_setting(pcavPyFw *self, PyObject *args, double (IpcavFw::*get)(int, int, int32_t *))
+{
+    std::string err;
+    bool failed = false;
+    int cavity, probe;
+    int32_t raw = 0;
+    double v = 0.;
+
+    if(!PyArg_ParseTuple(args, "ii", &cavity, &probe)) return 0;
+
+    PCAVPY_CALL(v = ((*self->fw).*get)(cavity, probe, &raw))
+    if(failed) return pcavPyError(err);
+
+    return Py_BuildValue("(dl)", v, (long) raw);
+}
+
+static PyObject *fw_get_phase_offset(pcavPyFw *self, PyObject *args) { return fw_get_setting(self, args, &IpcavFw::getPhaseOffset); }
+static PyObject *fw_get_weight(pcavPyFw *self, PyObject *args)       { return fw_get_setting(self, args, &IpcavFw::getWeight); }
+
+static PyObject *fw_probe_field(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    int cavity, probe, field;
+    int32_t raw = 0;
+    double v = 0.;
+
+    if(!PyArg_ParseTuple(args, "iii", &cavity, &probe, &field)) return 0;
+
+    PCAVPY_CALL(v = self->fw->getProbeField(cavity, probe, (pcavProbeField) field, &raw))
+    if(failed) return pcavPyError(err);
+
+    return Py_BuildValue("(dl)", v, (long) raw);
+}
+
+static PyObject *fw_ref_field(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    int field;
+    int32_t raw = 0;
+    double v = 0.;
+
+    if(!PyArg_ParseTuple(args, "i", &field)) return 0;
+
+    PCAVPY_CALL(v = self->fw->getRefField((pcavRefField) field, &raw))
+    if(failed) return pcavPyError(err);
+
+    return Py_BuildValue("(dl)", v, (long) raw);
+}
+
+static PyObject *fw_set_latch_counter(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    const char *name = 0;
+    int timingId = 0;
+
+    if(!PyArg_ParseTuple(args, "z|p", &name, &timingId)) return 0;
+
+    PCAVPY_CALL(self->fw->setLatchCounter(name, timingId))
+    if(failed) return pcavPyError(err);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *fw_coherent_stats(pcavPyFw *self, PyObject *args)
+{
+    pcavCoherentStats stats;
+
+    self->fw->getCoherentStats(&stats);
+
+    return Py_BuildValue("{s:K,s:K,s:K}", "reads", (unsigned long long) stats.reads,
+                         "torn", (unsigned long long) stats.torn, "failures", (unsigned long long) stats.failures);
+}
+
+static PyObject *fw_clear_coherent_stats(pcavPyFw *self, PyObject *args)
+{
+    self->fw->clearCoherentStats();
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *fw_version(pcavPyFw *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    int32_t version = 0;
+
+    PCAVPY_CALL(self->fw->getVersion(&version))
+    if(failed) return pcavPyError(err);
+
+    return PyLong_FromLong(version);
+}
+
+static PyMethodDef fw_methods[] = {
+    { "snapshot",         (PyCFunction) fw_snapshot,         METH_VARARGS | METH_KEYWORDS,
+      "snapshot(target, coherent=0), read all monitor registers into a Snapshot or the next History slot" },
+    { "set_nco",          (PyCFunction) fw_set_nco,          METH_VARARGS, "set_nco(cavity, hz), returns the register word" },
+    { "set_phase_offset", (PyCFunction) fw_set_phase_offset, METH_VARARGS, "set_phase_offset(cavity, probe, degree), returns the register word" },
+    { "set_calib_coeff",  (PyCFunction) fw_set_calib_coeff,  METH_VARARGS, "set_calib_coeff(cavity, probe, v), returns the register word" },
+    { "set_weight",       (PyCFunction) fw_set_weight,       METH_VARARGS, "set_weight(cavity, probe, v), returns the register word" },
+    { "set_nco_raw",          (PyCFunction) fw_set_nco_raw,          METH_VARARGS, "set_nco_raw(cavity, word)" },
+    { "set_phase_offset_raw", (PyCFunction) fw_set_phase_offset_raw, METH_VARARGS, "set_phase_offset_raw(cavity, probe, word)" },
+    { "set_calib_coeff_raw",  (PyCFunction) fw_set_calib_coeff_raw,  METH_VARARGS, "set_calib_coeff_raw(cavity, probe, word)" },
+    { "set_weight_raw",       (PyCFunction) fw_set_weight_raw,       METH_VARARGS, "set_weight_raw(cavity, probe, word)" },
+    { "set_ref_sel",          (PyCFunction) fw_set_ref_sel,          METH_VARARGS, "set_ref_sel(channel)" },
+    { "set_wf_data_sel",      (PyCFunction) fw_set_wf_data_sel,      METH_VARARGS, "set_wf_data_sel(index, sel)" },
+    { "set_chan_sel",         (PyCFunction) fw_set_chan_sel,         METH_VARARGS, "set_chan_sel(cavity, probe, channel)" },
+    { "set_window_start",     (PyCFunction) fw_set_window_start,     METH_VARARGS, "set_window_start(cavity, probe, start)" },
+    { "set_window_end",       (PyCFunction) fw_set_window_end,       METH_VARARGS, "set_window_end(cavity, probe, end)" },
+    { "set_freq_eval_start",  (PyCFunction) fw_set_freq_eval_start,  METH_VARARGS, "set_freq_eval_start(cavity, start)" },
+    { "set_freq_eval_end",    (PyCFunction) fw_set_freq_eval_end,    METH_VARARGS, "set_freq_eval_end(cavity, end)" },
+    { "set_reg_latch_point",  (PyCFunction) fw_set_reg_latch_point,  METH_VARARGS, "set_reg_latch_point(cavity, point)" },
+    { "get_phase_offset",     (PyCFunction) fw_get_phase_offset,     METH_VARARGS, "get_phase_offset(cavity, probe), (degree, raw)" },
+    { "get_weight",           (PyCFunction) fw_get_weight,           METH_VARARGS, "get_weight(cavity, probe), (v, raw)" },
+    { "probe_field",          (PyCFunction) fw_probe_field,          METH_VARARGS, "probe_field(cavity, probe, field), (v, raw), field is IF_AMPL ... COMP_PHASE" },
+    { "ref_field",            (PyCFunction) fw_ref_field,            METH_VARARGS, "ref_field(field), (v, raw), field is REF_AMPL ... REF_Q" },
+    { "set_latch_counter",    (PyCFunction) fw_set_latch_counter,    METH_VARARGS, "set_latch_counter(name, timing_id=False), register under PcavReg, None to remove, timing_id if it latches the timing pulse ID" },
+    { "coherent_stats",       (PyCFunction) fw_coherent_stats,       METH_NOARGS,  "coherent snapshot counters, dict of reads, torn and failures" },
+    { "clear_coherent_stats", (PyCFunction) fw_clear_coherent_stats, METH_NOARGS,  "clear the coherent snapshot counters" },
+    { "version",          (PyCFunction) fw_version,          METH_NOARGS,  "firmware version" },
+    { 0 }
+};
+
+
+//
+// DacSigGen
+//
+
+static int dac_init(pcavPyDac *self, PyObject *args, PyObject *kwds)
+{
+    static const char *kwlist[] = { "yaml", "path", "root", 0 };
+    const char *yaml, *path, *root = "NetIODev";
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "ss|s", (char **) kwlist, &yaml, &path, &root)) return -1;
+
+    try {
+        Path p = IPath::loadYamlFile(yaml, root);
+        self->dac = IdacSigGenFw::create(p->findByName(path));
+    } catch(CPSWError &e) {
+        PyErr_SetString(PyExc_RuntimeError, e.getInfo().c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+static PyObject *dac_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcavPyDac *self = (pcavPyDac *) type->tp_alloc(type, 0);
+
+    if(self) new (&self->dac) dacSigGenFw();
+
+    return (PyObject *) self;
+}
+
+static void dac_dealloc(pcavPyDac *self)
+{
+    self->dac.~dacSigGenFw();
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+// the table is taken in place from any C-contiguous int16, float32 or float64 buffer of up to MAX_SAMPLES
+static int dac_table(PyObject *obj, Py_buffer *buf)
+{
+    if(PyObject_GetBuffer(obj, buf, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT)) return -1;
+    if((strcmp(buf->format, "h") && strcmp(buf->format, "f") && strcmp(buf->format, "d")) ||
+       buf->len == 0 || buf->len / buf->itemsize > MAX_SAMPLES) {
+        PyErr_Format(PyExc_ValueError, "waveform must be 1..%d contiguous int16, float32 or float64 samples", MAX_SAMPLES);
+        PyBuffer_Release(buf);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int dac_upload(IdacSigGenFw *dac, int channel, Py_buffer *buf)
+{
+    unsigned n = buf->len / buf->itemsize;
+
+    switch(buf->format[0]) {
+        case 'h': return dac->setWaveform(channel, (const int16_t *) buf->buf, n);
+        case 'f': return dac->setWaveform(channel, (const float *) buf->buf, n);
+        default:  return dac->setWaveform(channel, (const double *) buf->buf, n);
+    }
+}
+
+static PyObject *dac_set_waveform(pcavPyDac *self, PyObject *args)
+{
+    std::string err;
+    bool failed = false;
+    PyObject *i_obj, *q_obj;
+    Py_buffer i_buf, q_buf;
+    int status = 0;
+
+    if(!PyArg_ParseTuple(args, "OO", &i_obj, &q_obj)) return 0;
+    if(dac_table(i_obj, &i_buf)) return 0;
+    if(dac_table(q_obj, &q_buf)) {
+        PyBuffer_Release(&i_buf);
+        return 0;
+    }
+    if(i_buf.len / i_buf.itemsize != q_buf.len / q_buf.itemsize) {
+        PyErr_SetString(PyExc_ValueError, "I and Q must have the same length");
+        PyBuffer_Release(&i_buf);
+        PyBuffer_Release(&q_buf);
+        return 0;
+    }
+
+    PCAVPY_CALL(status = dac_upload(self->dac.get(), DAC_CHANNEL_I, &i_buf);
+                if(!status) status = dac_upload(self->dac.get(), DAC_CHANNEL_Q, &q_buf))
+
+    PyBuffer_Release(&i_buf);
+    PyBuffer_Release(&q_buf);
+    if(failed) return pcavPyError(err);
+    if(status) {
+        PyErr_SetString(PyExc_ValueError, "waveform rejected");
+        return 0;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *dac_set_mask(pcavPyDac *self, PyObject *args, int (IdacSigGenFw::*set)(int, bool))
+{
+    std::string err;
+    bool failed = false;
+    int channel, on, status = 0;
+
+    if(!PyArg_ParseTuple(args, "ip", &channel, &on)) return 0;
+
+    PCAVPY_CALL(status = ((*self->dac).*set)(channel, on))
+    if(failed) return pcavPyError(err);
+    if(status) {
+        PyErr_SetString(PyExc_ValueError, "invalid channel");
+        return 0;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *dac_set_continuous(pcavPyDac *self, PyObject *args) { return dac_set_mask(self, args, &IdacSigGenFw::setContinuous); }
+static PyObject *dac_set_enable(pcavPyDac *self, PyObject *args)     { return dac_set_mask(self, args, &IdacSigGenFw::setEnable); }
+
+static PyMethodDef dac_methods[] = {
+    { "set_waveform",   (PyCFunction) dac_set_waveform,   METH_VARARGS, "set_waveform(i, q), int16, float32 or float64 arrays, PeriodSize follows the length" },
+    { "set_continuous", (PyCFunction) dac_set_continuous, METH_VARARGS, "set_continuous(channel, on), ModeMask bit" },
+    { "set_enable",     (PyCFunction) dac_set_enable,     METH_VARARGS, "set_enable(channel, on), EnableMask bit" },
+    { 0 }
+};
+
+
+//
+// module
+//
+
+static struct PyModuleDef pcavPyModule = {
+    PyModuleDef_HEAD_INIT, "pcav", "pcavLib bindings, arrays are zero-copy buffer views", -1, 0
+};
+
+static int add_type(PyObject *m, PyTypeObject *type, const char *name)
+{
+    if(PyType_Ready(type) < 0) return -1;
+    Py_INCREF(type);
+
+    return PyModule_AddObject(m, name, (PyObject *) type);
+}
+
+PyMODINIT_FUNC PyInit_pcav(void)
+{
+    pcavPyViewType.tp_basicsize   = sizeof(pcavPyView);
+    pcavPyViewType.tp_flags       = Py_TPFLAGS_DEFAULT;
+    pcavPyViewType.tp_dealloc     = (destructor) view_dealloc;
+    pcavPyViewType.tp_as_buffer   = &view_as_buffer;
+    pcavPyViewType.tp_doc         = "read-only view on library memory, use numpy.asarray()";
+
+    pcavPySnapshotType.tp_basicsize = sizeof(pcavPySnapshot);
+    pcavPySnapshotType.tp_flags     = Py_TPFLAGS_DEFAULT;
+    pcavPySnapshotType.tp_new       = snapshot_new;
+    pcavPySnapshotType.tp_as_buffer = &snapshot_as_buffer;
+    pcavPySnapshotType.tp_members   = snapshot_members;
+    pcavPySnapshotType.tp_getset    = snapshot_getset;
+    pcavPySnapshotType.tp_doc       = "one snapshot, the buffer is val[cavity][probe][field]";
+
+    pcavPyHistoryType.tp_basicsize   = sizeof(pcavPyHistory);
+    pcavPyHistoryType.tp_flags       = Py_TPFLAGS_DEFAULT;
+    pcavPyHistoryType.tp_new         = PyType_GenericNew;
+    pcavPyHistoryType.tp_init        = (initproc) history_init;
+    pcavPyHistoryType.tp_dealloc     = (destructor) history_dealloc;
+    pcavPyHistoryType.tp_methods     = history_methods;
+    pcavPyHistoryType.tp_getset      = history_getset;
+    pcavPyHistoryType.tp_as_sequence = &history_as_sequence;
+    pcavPyHistoryType.tp_doc         = "History(depth), pulse history ring";
+
+    pcavPyFwType.tp_basicsize = sizeof(pcavPyFw);
+    pcavPyFwType.tp_flags     = Py_TPFLAGS_DEFAULT;
+    pcavPyFwType.tp_new       = fw_new;
+    pcavPyFwType.tp_init      = (initproc) fw_init;
+    pcavPyFwType.tp_dealloc   = (destructor) fw_dealloc;
+    pcavPyFwType.tp_methods   = fw_methods;
+    pcavPyFwType.tp_doc       = "Fw(yaml, path, root='NetIODev'), IpcavFw";
+
+    pcavPyDacType.tp_basicsize = sizeof(pcavPyDac);
+    pcavPyDacType.tp_flags     = Py_TPFLAGS_DEFAULT;
+    pcavPyDacType.tp_new       = dac_new;
+    pcavPyDacType.tp_init      = (initproc) dac_init;
+    pcavPyDacType.tp_dealloc   = (destructor) dac_dealloc;
+    pcavPyDacType.tp_methods   = dac_methods;
+    pcavPyDacType.tp_doc       = "DacSigGen(yaml, path, root='NetIODev'), IdacSigGenFw";
+
+    PyObject *m = PyModule_Create(&pcavPyModule);
+    if(!m) return 0;
+
+    if(add_type(m, &pcavPyViewType,     "View")      ||
+       add_type(m, &pcavPySnapshotType, "Snapshot")  ||
+       add_type(m, &pcavPyHistoryType,  "History")   ||
+       add_type(m, &pcavPyFwType,       "Fw")        ||
+       add_type(m, &pcavPyDacType,      "DacSigGen")) {
+        Py_DECREF(m);
+        return 0;
+    }
+
+    static const struct { const char *name; int v; } consts[] = {
+        { "IF_AMPL",    PCAV_IF_AMPL },    { "IF_PHASE",   PCAV_IF_PHASE },   { "IF_I",      PCAV_IF_I },
+        { "IF_Q",       PCAV_IF_Q },       { "DC_REAL",    PCAV_DC_REAL },    { "DC_IMAGE",  PCAV_DC_IMAGE },
+        { "DC_FREQ",    PCAV_DC_FREQ },    { "INTEG_I",    PCAV_INTEG_I },    { "INTEG_Q",   PCAV_INTEG_Q },
+        { "OUT_PHASE",  PCAV_OUT_PHASE },  { "OUT_AMPL",   PCAV_OUT_AMPL },   { "COMP_PHASE", PCAV_COMP_PHASE },
+        { "REF_AMPL",   PCAV_REF_AMPL },   { "REF_PHASE",  PCAV_REF_PHASE },  { "REF_I",     PCAV_REF_I },
+        { "REF_Q",      PCAV_REF_Q },
+        { "SNAP_COHERENT", PCAV_SNAP_COHERENT }, { "SNAP_TORN", PCAV_SNAP_TORN }, { "SNAP_HW_ID", PCAV_SNAP_HW_ID },
+        { "MAX_SAMPLES", MAX_SAMPLES }, { "CHANNEL_I", DAC_CHANNEL_I }, { "CHANNEL_Q", DAC_CHANNEL_Q },
+    };
+    for(size_t i = 0; i < sizeof(consts) / sizeof(consts[0]); i++) PyModule_AddIntConstant(m, consts[i].name, consts[i].v);
+
+    return m;
+}
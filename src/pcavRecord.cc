@@ -0,0 +1,308 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavRecord.h"
+#include "pcavUtil.h"
+
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+
+
+// outward rounding to float, the summary never excludes a value of the chunk
+static float float_down(double v) { float f = (float) v; return (double) f > v ? nextafterf(f, -INFINITY) : f; }
+static float float_up(double v)   { float f = (float) v; return (double) f < v ? nextafterf(f,  INFINITY) : f; }
+
+
+CpcavRecorder::CpcavRecorder(unsigned chunkCount):
+    fp_(0), offset_(0), chunkCount_(chunkCount),
+    buf_(chunkCount), n_(0),
+    block_(CpcavCodec::maxBlockBytes(chunkCount)),
+    codec_(chunkCount)
+{
+}
+
+pcavRecorder CpcavRecorder::create(const char *path, unsigned chunkCount)
+{
+    if(!chunkCount) chunkCount = 1;
+
+    pcavRecorder r(new CpcavRecorder(chunkCount));
+    pcavRecFileHeader hdr;
+
+    if(!(r->fp_ = fopen(path, "wb"))) {
+        fprintf(stderr, "CpcavRecorder: %s (%s)\n", path, strerror(errno));
+        return pcavRecorder();
+    }
+
+    hdr.magic      = PCAV_REC_MAGIC;
+    hdr.version    = PCAV_REC_VERSION;
+    hdr.chunkCount = chunkCount;
+    hdr.fields     = PCAV_REC_FIELDS;
+    if(fwrite(&hdr, sizeof(hdr), 1, r->fp_) != 1) {
+        fprintf(stderr, "CpcavRecorder: %s (%s)\n", path, strerror(errno));
+        return pcavRecorder();
+    }
+    r->offset_ = sizeof(hdr);
+
+    return r;
+}
+
+CpcavRecorder::~CpcavRecorder()
+{
+    close();
+}
+
+int CpcavRecorder::writeChunk(void)
+{
+    pcavRecChunkInfo info;
+    size_t bytes = codec_.encode(&buf_[0], n_, &block_[0]);
+
+    if(!bytes) return -1;
+
+    memset(&info, 0, sizeof(info));
+    info.magic        = PCAV_REC_CHUNK_MAGIC;
+    info.bytes        = (uint32_t) bytes;
+    info.offset       = offset_ + sizeof(info);
+    info.count        = n_;
+    info.firstPulseId = buf_[0].pulseId;
+    info.lastPulseId  = buf_[n_ - 1].pulseId;
+    info.firstTime    = (int64_t) buf_[0].ts.tv_sec * 1000000000 + buf_[0].ts.tv_nsec;
+    info.lastTime     = (int64_t) buf_[n_ - 1].ts.tv_sec * 1000000000 + buf_[n_ - 1].ts.tv_nsec;
+
+    for(int k = 0; k < PCAV_REC_FIELDS; k++) {
+        double lo = INFINITY, hi = -INFINITY, sum = 0.;
+        for(unsigned i = 0; i < n_; i++) {
+            double v = field_value(buf_[i], k);
+            lo   = v < lo ? v : lo;
+            hi   = v > hi ? v : hi;
+            sum += v;
+        }
+        info.sum[k].min  = float_down(lo);
+        info.sum[k].max  = float_up(hi);
+        info.sum[k].mean = (float) (sum / n_);
+    }
+
+    if(fwrite(&info, sizeof(info), 1, fp_) != 1 || fwrite(&block_[0], bytes, 1, fp_) != 1) {
+        fprintf(stderr, "CpcavRecorder: write failed (%s)\n", strerror(errno));
+        return -1;
+    }
+    offset_ += sizeof(info) + bytes;
+    index_.push_back(info);
+    n_ = 0;
+
+    return 0;
+}
+
+int CpcavRecorder::write(const pcavSnapshot &snap)
+{
+    if(!fp_) return -1;
+
+    buf_[n_++] = snap;
+
+    return n_ == chunkCount_ ? writeChunk() : 0;
+}
+
+int CpcavRecorder::flush(void)
+{
+    if(!fp_) return -1;
+    if(n_ && writeChunk()) return -1;
+
+    return fflush(fp_) ? -1 : 0;
+}
+
+int CpcavRecorder::close(void)
+{
+    pcavRecTrailer trailer;
+    int status = 0;
+
+    if(!fp_) return 0;
+    if(flush()) status = -1;
+
+    trailer.indexOffset = offset_;
+    trailer.chunks      = index_.size();
+    trailer.magic       = PCAV_REC_INDEX_MAGIC;
+    trailer.version     = PCAV_REC_VERSION;
+    if((index_.size() && fwrite(&index_[0], sizeof(pcavRecChunkInfo), index_.size(), fp_) != index_.size()) ||
+       fwrite(&trailer, sizeof(trailer), 1, fp_) != 1) {
+        fprintf(stderr, "CpcavRecorder: index write failed (%s)\n", strerror(errno));
+        status = -1;
+    }
+    if(fclose(fp_)) status = -1;
+    fp_ = 0;
+
+    return status;
+}
+
+
+CpcavRecordReader::CpcavRecordReader():
+    fp_(0), codec_(0), recovered_(false)
+{
+}
+
+CpcavRecordReader::~CpcavRecordReader()
+{
+    if(fp_) fclose(fp_);
+    delete codec_;
+}
+
+pcavRecordReader CpcavRecordReader::open(const char *path)
+{
+    pcavRecordReader r(new CpcavRecordReader());
+
+    if(!(r->fp_ = fopen(path, "rb"))) {
+        fprintf(stderr, "CpcavRecordReader: %s (%s)\n", path, strerror(errno));
+        return pcavRecordReader();
+    }
+    if(fread(&r->hdr_, sizeof(r->hdr_), 1, r->fp_) != 1 ||
+       r->hdr_.magic != PCAV_REC_MAGIC || r->hdr_.version != PCAV_REC_VERSION ||
+       r->hdr_.fields != PCAV_REC_FIELDS || r->hdr_.chunkCount == 0) {
+        fprintf(stderr, "CpcavRecordReader: %s is not a pcav recording\n", path);
+        return pcavRecordReader();
+    }
+
+    if(r->loadIndex()) {
+        r->recovered_ = true;
+        if(r->scanIndex()) return pcavRecordReader();
+    }
+
+    r->codec_ = new CpcavCodec(r->hdr_.chunkCount);
+    r->buf_.resize(r->hdr_.chunkCount);
+    r->block_.resize(CpcavCodec::maxBlockBytes(r->hdr_.chunkCount));
+
+    return r;
+}
+
+// index from the trailer
+int CpcavRecordReader::loadIndex(void)
+{
+    pcavRecTrailer trailer;
+    off_t end;
+
+    if(fseeko(fp_, -(off_t) sizeof(trailer), SEEK_END) || (end = ftello(fp_)) < 0 ||
+       fread(&trailer, sizeof(trailer), 1, fp_) != 1 ||
+       trailer.magic != PCAV_REC_INDEX_MAGIC || trailer.version != PCAV_REC_VERSION) return -1;
+
+    // the index sits between indexOffset and the trailer, a count it cannot hold is a damaged trailer
+    if(trailer.indexOffset < sizeof(hdr_) || trailer.indexOffset > (uint64_t) end ||
+       trailer.chunks > ((uint64_t) end - trailer.indexOffset) / sizeof(pcavRecChunkInfo)) return -1;
+
+    index_.resize(trailer.chunks);
+    if(fseeko(fp_, (off_t) trailer.indexOffset, SEEK_SET) ||
+       (trailer.chunks && fread(&index_[0], sizeof(pcavRecChunkInfo), trailer.chunks, fp_) != trailer.chunks)) {
+        index_.clear();
+        return -1;
+    }
+
+    return 0;
+}
+
+// index from the chunk records, up to the first incomplete one
+int CpcavRecordReader::scanIndex(void)
+{
+    pcavRecChunkInfo info;
+    off_t offset = sizeof(hdr_);
+
+    index_.clear();
+    while(!fseeko(fp_, offset, SEEK_SET) && fread(&info, sizeof(info), 1, fp_) == 1) {
+        if(info.magic != PCAV_REC_CHUNK_MAGIC || info.offset != (uint64_t) offset + sizeof(info) ||
+           info.count == 0 || info.count > hdr_.chunkCount) break;
+        if(fseeko(fp_, (off_t) (info.offset + info.bytes), SEEK_SET)) break;
+        if(ftello(fp_) != (off_t) (info.offset + info.bytes)) break;
+        index_.push_back(info);
+        offset = (off_t) (info.offset + info.bytes);
+    }
+
+    return 0;
+}
+
+size_t CpcavRecordReader::findTime(int64_t t) const
+{
+    size_t lo = 0, hi = index_.size();
+
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(index_[mid].lastTime < t) lo = mid + 1;
+        else                         hi = mid;
+    }
+
+    return lo;
+}
+
+size_t CpcavRecordReader::findPulseId(uint64_t id) const
+{
+    size_t lo = 0, hi = index_.size();
+
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(index_[mid].lastPulseId < id) lo = mid + 1;
+        else                             hi = mid;
+    }
+
+    return lo;
+}
+
+int CpcavRecordReader::readChunk(size_t i, const pcavSnapshot **snap)
+{
+    if(i >= index_.size()) return -1;
+
+    const pcavRecChunkInfo &info = index_[i];
+    if(info.bytes > block_.size() ||
+       fseeko(fp_, (off_t) info.offset, SEEK_SET) ||
+       fread(&block_[0], info.bytes, 1, fp_) != 1) return -1;
+
+    int n = codec_->decode(&block_[0], info.bytes, &buf_[0]);
+    if(n >= 0) *snap = &buf_[0];
+
+    return n;
+}
+
+int64_t CpcavRecordReader::query(const pcavRecQuery &q, pcavRecVisitor visit, void *arg, pcavRecQueryStats *stats)
+{
+    pcavRecQueryStats st;
+    int64_t visited = 0;
+    bool    more    = true;
+
+    memset(&st, 0, sizeof(st));
+    if(q.field >= PCAV_REC_FIELDS) return -1;
+
+    for(size_t i = findTime(q.t0); more && i < index_.size() && index_[i].firstTime <= q.t1; i++) {
+        const pcavRecChunkInfo &info = index_[i];
+
+        if(info.lastPulseId < q.id0 || info.firstPulseId > q.id1 ||
+           (q.field >= 0 && (info.sum[q.field].max < q.min || info.sum[q.field].min > q.max))) {
+            st.chunksSkipped++;
+            continue;
+        }
+
+        const pcavSnapshot *snap;
+        int n = readChunk(i, &snap);
+        if(n < 0) {
+            if(stats) *stats = st;
+            return -1;
+        }
+        st.chunksRead++;
+        st.bytesRead += info.bytes;
+
+        for(int k = 0; more && k < n; k++) {
+            const pcavSnapshot &s = snap[k];
+            int64_t t = (int64_t) s.ts.tv_sec * 1000000000 + s.ts.tv_nsec;
+            if(t < q.t0 || t > q.t1 || s.pulseId < q.id0 || s.pulseId > q.id1) continue;
+            if(q.field >= 0) {
+                double v = field_value(s, q.field);
+                if(v < q.min || v > q.max) continue;
+            }
+            st.matches++;
+            visited++;
+            more = visit(arg, s);
+        }
+    }
+    if(stats) *stats = st;
+
+    return visited;
+}
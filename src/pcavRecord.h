@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVRECORD_H
+#define _PCAVRECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "pcavFw.h"
+#include "pcavCodec.h"
+
+#define PCAV_REC_MAGIC        0x70637266     // 'pcrf', file header
+#define PCAV_REC_CHUNK_MAGIC  0x70637263     // 'pcrc', chunk record
+#define PCAV_REC_INDEX_MAGIC  0x70637269     // 'pcri', trailer
+#define PCAV_REC_VERSION      1
+
+// summary fields, the reference fields then [cavity][probe][field]
+#define PCAV_REC_FIELDS       (PCAV_NUM_REF_FIELDS + PCAV_NUM_CAVITY * PCAV_NUM_PROBE * PCAV_NUM_PROBE_FIELDS)
+
+inline int pcavRecField(pcavRefField f) { return f; }
+inline int pcavRecField(int cavity, int probe, pcavProbeField f)
+{
+    return PCAV_NUM_REF_FIELDS + (cavity * PCAV_NUM_PROBE + probe) * PCAV_NUM_PROBE_FIELDS + f;
+}
+
+// recording file, native byte order
+//   file header
+//   chunk records: pcavRecChunkInfo followed by one pcavCodec block of up to chunkCount snapshots
+//   index: a copy of every pcavRecChunkInfo, then the trailer
+// a file without trailer (recorder killed) is indexed by scanning the chunk records
+struct pcavRecFileHeader {
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  chunkCount;
+    uint32_t  fields;
+};
+
+struct pcavRecSummary {
+    float     min;             // rounded outwards, safe for skipping
+    float     max;
+    float     mean;
+};
+
+struct pcavRecChunkInfo {
+    uint32_t  magic;
+    uint32_t  bytes;           // codec block size
+    uint64_t  offset;          // of the codec block in the file
+    uint32_t  count;
+    uint32_t  reserved;
+    uint64_t  firstPulseId;
+    uint64_t  lastPulseId;
+    int64_t   firstTime;       // ns since the epoch
+    int64_t   lastTime;
+    pcavRecSummary sum[PCAV_REC_FIELDS];
+};
+
+struct pcavRecTrailer {
+    uint64_t  indexOffset;
+    uint64_t  chunks;
+    uint32_t  magic;
+    uint32_t  version;
+};
+
+
+class CpcavRecorder;
+typedef shared_ptr<CpcavRecorder> pcavRecorder;
+
+class CpcavRecorder {
+private:
+    FILE     *fp_;
+    uint64_t  offset_;
+    unsigned  chunkCount_;
+    std::vector<pcavSnapshot> buf_;
+    unsigned  n_;
+    std::vector<uint8_t> block_;
+    std::vector<pcavRecChunkInfo> index_;
+    CpcavCodec codec_;
+
+    CpcavRecorder(unsigned chunkCount);
+    int       writeChunk(void);
+
+public:
+    // creates path, empty pointer on failure
+    static pcavRecorder create(const char *path, unsigned chunkCount = 256);
+    ~CpcavRecorder();
+
+    int       write(const pcavSnapshot &snap);   // writes a chunk every chunkCount snapshots
+    int       flush(void);                       // writes the partial chunk
+    int       close(void);                       // flush, index and trailer
+};
+
+
+// query: time and pulse ID ranges are inclusive, a field predicate selects snapshots with min <= value <= max
+struct pcavRecQuery {
+    int64_t   t0, t1;          // ns since the epoch
+    uint64_t  id0, id1;
+    int       field;           // pcavRecField(), -1 for none
+    double    min, max;
+
+    pcavRecQuery(): t0(INT64_MIN), t1(INT64_MAX), id0(0), id1(UINT64_MAX), field(-1), min(0.), max(0.) {}
+};
+
+struct pcavRecQueryStats {
+    uint64_t  chunksRead;
+    uint64_t  chunksSkipped;   // by the pulse ID range or the summary
+    uint64_t  bytesRead;
+    uint64_t  matches;
+};
+
+typedef bool (*pcavRecVisitor)(void *arg, const pcavSnapshot &snap);    // return false to stop
+
+class CpcavRecordReader;
+typedef shared_ptr<CpcavRecordReader> pcavRecordReader;
+
+class CpcavRecordReader {
+private:
+    FILE     *fp_;
+    pcavRecFileHeader hdr_;
+    std::vector<pcavRecChunkInfo> index_;
+    std::vector<pcavSnapshot> buf_;
+    std::vector<uint8_t> block_;
+    CpcavCodec *codec_;
+    bool      recovered_;
+
+    CpcavRecordReader();
+    int       loadIndex(void);
+    int       scanIndex(void);
+
+public:
+    static pcavRecordReader open(const char *path);
+    ~CpcavRecordReader();
+
+    size_t    chunks(void) const { return index_.size(); }
+    const pcavRecChunkInfo *chunk(size_t i) const { return i < index_.size() ? &index_[i] : 0; }
+    bool      recovered(void) const { return recovered_; }    // index rebuilt by scanning
+
+    size_t    findTime(int64_t t) const;          // first chunk which ends at or after t
+    size_t    findPulseId(uint64_t id) const;     // first chunk which ends at or after id
+
+    // decode chunk i, the snapshots stay valid until the next read, returns the count or -1
+    int       readChunk(size_t i, const pcavSnapshot **snap);
+
+    // visit the matching snapshots in file order, returns the number visited or -1 on a read error
+    int64_t   query(const pcavRecQuery &q, pcavRecVisitor visit, void *arg, pcavRecQueryStats *stats = 0);
+};
+
+#endif /* _PCAVRECORD_H */
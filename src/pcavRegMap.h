@@ -0,0 +1,233 @@
+// generated by genRegMap.py, do not edit
+//
+#ifndef _PCAVREGMAP_H
+#define _PCAVREGMAP_H
+
+#include <stdint.h>
+
+#include "pcavFw.h"
+
+#define PCAV_REG_NO_OFFSET  0xffffffff
+
+struct pcavRegDesc {
+    const char *name;
+    uint32_t    offset;         // byte offset in the register block, PCAV_REG_NO_OFFSET if unknown
+    uint8_t     bits;
+    bool        isSigned;
+    uint8_t     frac;           // fraction bits
+    double      scale;          // engineering unit per full scale, 180 for phases in degree
+};
+
+// raw register word to fixed point value, masked to the field width
+template <unsigned BITS, unsigned FRAC, bool SIGNED>
+inline double pcavFix(int32_t raw)
+{
+    const uint64_t mask = (BITS >= 32) ? 0xffffffffULL : ((1ULL << BITS) - 1);
+    uint64_t v = (uint64_t) (uint32_t) raw & mask;
+
+    if(SIGNED && (v & (1ULL << (BITS - 1)))) return ((double) v - (double) (1ULL << BITS)) / (double) (1ULL << FRAC);
+
+    return (double) v / (double) (1ULL << FRAC);
+}
+
+template <int FIELD> struct pcavProbeFmt;
+template <int FIELD> struct pcavRefFmt;
+
+template <> struct pcavProbeFmt<PCAV_IF_AMPL> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_IF_PHASE> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 180.0; }
+};
+template <> struct pcavProbeFmt<PCAV_IF_I> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_IF_Q> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_DC_REAL> {
+    enum { bits = 21, frac = 19, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_DC_IMAGE> {
+    enum { bits = 21, frac = 19, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_DC_FREQ> {
+    enum { bits = 32, frac = 18, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_INTEG_I> {
+    enum { bits = 18, frac = 16, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_INTEG_Q> {
+    enum { bits = 18, frac = 16, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_OUT_PHASE> {
+    enum { bits = 18, frac = 15, isSigned = 1 };
+    static double scale(void) { return 180.0; }
+};
+template <> struct pcavProbeFmt<PCAV_OUT_AMPL> {
+    enum { bits = 18, frac = 16, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavProbeFmt<PCAV_COMP_PHASE> {
+    enum { bits = 18, frac = 15, isSigned = 1 };
+    static double scale(void) { return 180.0; }
+};
+
+template <> struct pcavRefFmt<PCAV_REF_AMPL> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavRefFmt<PCAV_REF_PHASE> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 180.0; }
+};
+template <> struct pcavRefFmt<PCAV_REF_I> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+template <> struct pcavRefFmt<PCAV_REF_Q> {
+    enum { bits = 18, frac = 17, isSigned = 1 };
+    static double scale(void) { return 1.0; }
+};
+
+struct pcavPhaseOffsetFmt {
+    enum { bits = 18, frac = 15, isSigned = 1 };
+    static double scale(void) { return 180.0; }
+};
+struct pcavWeightFmt {
+    enum { bits = 2, frac = 1, isSigned = 0 };
+    static double scale(void) { return 1.0; }
+};
+
+template <int FIELD>
+inline double pcavProbeConv(int32_t raw)
+{
+    typedef pcavProbeFmt<FIELD> F;
+
+    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);
+}
+
+template <int FIELD>
+inline double pcavRefConv(int32_t raw)
+{
+    typedef pcavRefFmt<FIELD> F;
+
+    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);
+}
+
+template <typename F>
+inline double pcavSettingConv(int32_t raw)
+{
+    return F::scale() * pcavFix<F::bits, F::frac, (bool) F::isSigned>(raw);
+}
+
+// [cavity][probe][field], under PcavReg
+static const pcavRegDesc pcavProbeRegDesc[2][2][12] = {
+    {
+        {
+            { "cav1P1IfAmpl",              PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P1IfPhase",             PCAV_REG_NO_OFFSET, 18, true , 17, 180.0 },
+            { "cav1P1IfI",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P1IfQ",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P1DCReal",              PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav1P1DCImage",             PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav1P1DCFreq",              PCAV_REG_NO_OFFSET, 32, true , 18,   1.0 },
+            { "cav1P1IntegI",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P1IntegQ",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P1OutPhase",            PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "cav1P1OutAmpl",             PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P1CompPhase",           PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+        },
+        {
+            { "cav1P2IfAmpl",              PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P2IfPhase",             PCAV_REG_NO_OFFSET, 18, true , 17, 180.0 },
+            { "cav1P2IfI",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P2IfQ",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav1P2DCReal",              PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav1P2DCImage",             PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav1P2DCFreq",              PCAV_REG_NO_OFFSET, 32, true , 18,   1.0 },
+            { "cav1P2IntegI",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P2IntegQ",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P2OutPhase",            PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "cav1P2OutAmpl",             PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav1P2CompPhase",           PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+        },
+    },
+    {
+        {
+            { "cav2P1IfAmpl",              PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P1IfPhase",             PCAV_REG_NO_OFFSET, 18, true , 17, 180.0 },
+            { "cav2P1IfI",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P1IfQ",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P1DCReal",              PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav2P1DCImage",             PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav2P1DCFreq",              PCAV_REG_NO_OFFSET, 32, true , 18,   1.0 },
+            { "cav2P1IntegI",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P1IntegQ",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P1OutPhase",            PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "cav2P1OutAmpl",             PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P1CompPhase",           PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+        },
+        {
+            { "cav2P2IfAmpl",              PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P2IfPhase",             PCAV_REG_NO_OFFSET, 18, true , 17, 180.0 },
+            { "cav2P2IfI",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P2IfQ",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+            { "cav2P2DCReal",              PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav2P2DCImage",             PCAV_REG_NO_OFFSET, 21, true , 19,   1.0 },
+            { "cav2P2DCFreq",              PCAV_REG_NO_OFFSET, 32, true , 18,   1.0 },
+            { "cav2P2IntegI",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P2IntegQ",              PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P2OutPhase",            PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "cav2P2OutAmpl",             PCAV_REG_NO_OFFSET, 18, true , 16,   1.0 },
+            { "cav2P2CompPhase",           PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+        },
+    },
+};
+
+// [field], under PcavReg
+static const pcavRegDesc pcavRefRegDesc[4] = {
+    { "rfRefAmpl",                 PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+    { "rfRefPhase",                PCAV_REG_NO_OFFSET, 18, true , 17, 180.0 },
+    { "rfRefI",                    PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+    { "rfRefQ",                    PCAV_REG_NO_OFFSET, 18, true , 17,   1.0 },
+};
+
+#define PCAV_SETTING_PHASE_OFFSET  0
+#define PCAV_SETTING_WEIGHT        1
+#define PCAV_NUM_SETTINGS          2
+
+// [cavity][probe][setting], under AppDiagnBus
+static const pcavRegDesc pcavSettingRegDesc[2][2][2] = {
+    {
+        {
+            { "Cavity0Probe0PhaseOffset",  PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "Cavity0Probe0Weight",       PCAV_REG_NO_OFFSET,  2, false,  1,   1.0 },
+        },
+        {
+            { "Cavity0Probe1PhaseOffset",  PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "Cavity0Probe1Weight",       PCAV_REG_NO_OFFSET,  2, false,  1,   1.0 },
+        },
+    },
+    {
+        {
+            { "Cavity1Probe0PhaseOffset",  PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "Cavity1Probe0Weight",       PCAV_REG_NO_OFFSET,  2, false,  1,   1.0 },
+        },
+        {
+            { "Cavity1Probe1PhaseOffset",  PCAV_REG_NO_OFFSET, 18, true , 15, 180.0 },
+            { "Cavity1Probe1Weight",       PCAV_REG_NO_OFFSET,  2, false,  1,   1.0 },
+        },
+    },
+};
+
+#endif /* _PCAVREGMAP_H */
@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavRt.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static void prefault_stack(size_t size)
+{
+    volatile char *buf = (volatile char *) alloca(size);
+    long page = sysconf(_SC_PAGESIZE);
+
+    for(size_t i = 0; i < size; i += page) buf[i] = 0;
+}
+
+static void prefault_heap(size_t size)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    char *buf = (char *) malloc(size);
+
+    if(!buf) return;
+    for(size_t i = 0; i < size; i += page) buf[i] = 0;
+    free(buf);    // stays in the arena, trimming is disabled
+}
+
+int pcavRtApply(const pcavRtProfile &profile)
+{
+    int status = 0;
+    int err;
+
+    if(profile.lockMemory) {
+        // keep freed memory in the arena and serve large blocks from it,
+        // otherwise a free() after start hands pages back and the next malloc() faults again
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if(mlockall(MCL_CURRENT | MCL_FUTURE)) {
+            err = errno;
+            fprintf(stderr, "pcavRtApply: mlockall failed (%s)\n", strerror(err));
+            if(!status) status = -err;
+        }
+    }
+
+    if(profile.prefaultStack) prefault_stack(profile.prefaultStack);
+    if(profile.prefaultHeap)  prefault_heap(profile.prefaultHeap);
+
+    if(profile.cpuMask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+            if(profile.cpuMask & ((uint64_t) 0x1 << i)) CPU_SET(i, &set);
+        }
+        if((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))) {
+            fprintf(stderr, "pcavRtApply: cpu affinity 0x%llx failed (%s)\n",
+                    (unsigned long long) profile.cpuMask, strerror(err));
+            if(!status) status = -err;
+        }
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if(profile.policy == SCHED_FIFO || profile.policy == SCHED_RR) param.sched_priority = profile.priority;
+    if((err = pthread_setschedparam(pthread_self(), profile.policy, &param))) {
+        fprintf(stderr, "pcavRtApply: scheduling policy %d, priority %d failed (%s)\n",
+                profile.policy, profile.priority, strerror(err));
+        if(!status) status = -err;
+    }
+
+    return status;
+}
+
+
+CpcavRtCheck::CpcavRtCheck()
+{
+    clear();
+}
+
+void CpcavRtCheck::clear(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+    minflt_ = majflt_ = nvcsw_ = nivcsw_ = 0;
+    inCycle_ = false;
+}
+
+void CpcavRtCheck::cycleStart(void)
+{
+    struct rusage u;
+
+    getrusage(RUSAGE_THREAD, &u);
+    minflt_ = u.ru_minflt;
+    majflt_ = u.ru_majflt;
+    nvcsw_  = u.ru_nvcsw;
+    nivcsw_ = u.ru_nivcsw;
+    inCycle_ = true;
+}
+
+void CpcavRtCheck::cycleEnd(void)
+{
+    struct rusage u;
+
+    if(!inCycle_) return;
+    getrusage(RUSAGE_THREAD, &u);
+
+    uint64_t minflt = u.ru_minflt - minflt_;
+    uint64_t majflt = u.ru_majflt - majflt_;
+    uint64_t nvcsw  = u.ru_nvcsw  - nvcsw_;
+    uint64_t nivcsw = u.ru_nivcsw - nivcsw_;
+
+    stats_.cycles++;
+    stats_.minorFaults += minflt;
+    stats_.majorFaults += majflt;
+    stats_.volCtxSw    += nvcsw;
+    stats_.involCtxSw  += nivcsw;
+    if(minflt + majflt > stats_.maxFaults) stats_.maxFaults = minflt + majflt;
+    if(nvcsw + nivcsw  > stats_.maxCtxSw)  stats_.maxCtxSw  = nvcsw + nivcsw;
+    if(minflt + majflt) stats_.faultCycles++;
+
+    inCycle_ = false;
+}
+
+void CpcavRtCheck::getStats(pcavRtStats *stats)
+{
+    *stats = stats_;
+}
+
+void CpcavRtCheck::report(void)
+{
+    double n = stats_.cycles ? (double) stats_.cycles : 1.;
+
+    printf("pcavRt self-check: %llu cycles\n", (unsigned long long) stats_.cycles);
+    printf("    page faults     : minor %llu, major %llu, %.3f per cycle, worst cycle %llu, cycles with faults %llu\n",
+           (unsigned long long) stats_.minorFaults, (unsigned long long) stats_.majorFaults,
+           (stats_.minorFaults + stats_.majorFaults) / n,
+           (unsigned long long) stats_.maxFaults, (unsigned long long) stats_.faultCycles);
+    printf("    context switches: voluntary %llu, involuntary %llu, %.3f per cycle, worst cycle %llu\n",
+           (unsigned long long) stats_.volCtxSw, (unsigned long long) stats_.involCtxSw,
+           (stats_.volCtxSw + stats_.involCtxSw) / n,
+           (unsigned long long) stats_.maxCtxSw);
+}
@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVRT_H
+#define _PCAVRT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sched.h>
+
+// execution profile for the threads which drive pcavLib (poll, feedback, recorder)
+// the owner of the thread applies the profile, threads spawned by the library
+// (CpcavPulseSync, CpcavPca, CpcavMetricsExporter) take it as an argument to start()
+struct pcavRtProfile {
+    int       policy;          // SCHED_OTHER, SCHED_FIFO or SCHED_RR
+    int       priority;        // static priority, used for SCHED_FIFO and SCHED_RR only
+    uint64_t  cpuMask;         // cpu affinity, bit n for cpu n, 0 keeps the inherited affinity
+    bool      lockMemory;      // mlockall() and disable heap trimming
+    size_t    prefaultStack;   // bytes of stack to touch up-front
+    size_t    prefaultHeap;    // bytes of heap to touch up-front and keep in the arena
+
+    pcavRtProfile(): policy(SCHED_OTHER), priority(0), cpuMask(0),
+                     lockMemory(false), prefaultStack(0), prefaultHeap(0) {}
+};
+
+// apply the profile to the calling thread, returns 0 on success or -errno of the first failure
+int pcavRtApply(const pcavRtProfile &profile);
+
+
+// per cycle self-check, page faults and context switches of the calling thread
+struct pcavRtStats {
+    uint64_t  cycles;
+    uint64_t  minorFaults;     // total over all cycles
+    uint64_t  majorFaults;
+    uint64_t  volCtxSw;
+    uint64_t  involCtxSw;
+    uint64_t  maxFaults;       // worst cycle, minor + major
+    uint64_t  maxCtxSw;        // worst cycle, voluntary + involuntary
+    uint64_t  faultCycles;     // number of cycles which took a page fault
+};
+
+class CpcavRtCheck {
+private:
+    long      minflt_;
+    long      majflt_;
+    long      nvcsw_;
+    long      nivcsw_;
+    bool      inCycle_;
+    pcavRtStats stats_;
+
+public:
+    CpcavRtCheck();
+
+    void  cycleStart(void);    // call on the thread which is checked
+    void  cycleEnd(void);
+    void  getStats(pcavRtStats *stats);
+    void  clear(void);
+    void  report(void);        // print summary to stdout
+};
+
+#endif /* _PCAVRT_H */
@@ -0,0 +1,175 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavScan.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+
+static int axis_points(const pcavScanAxis &a)
+{
+    if(a.step == 0 || a.stop < a.start) return 1;
+
+    return (a.stop - a.start) / a.step + 1;
+}
+
+CpcavScan::CpcavScan(pcavFw fw, CpcavHistory *history):
+    fw_(fw),
+    history_(history),
+    abort_(false)
+{
+}
+
+int CpcavScan::points(const pcavScanConfig &cfg)
+{
+    int n = 1;
+
+    for(int i = 0; i < cfg.nAxes; i++) n *= axis_points(cfg.axis[i]);
+
+    return n;
+}
+
+void CpcavScan::abort(void)
+{
+    abort_ = true;
+}
+
+void CpcavScan::write(const pcavScanAxis &axis, uint32_t value)
+{
+    switch(axis.param) {
+        case PCAV_SCAN_WINDOW_START:
+            fw_->setWindowStart(axis.cavity, axis.probe, value);
+            break;
+        case PCAV_SCAN_WINDOW_END:
+            fw_->setWindowEnd(axis.cavity, axis.probe, value);
+            break;
+        case PCAV_SCAN_FREQ_EVAL_START:
+            fw_->setFreqEvalStart(axis.cavity, value);
+            break;
+        case PCAV_SCAN_FREQ_EVAL_END:
+            fw_->setFreqEvalEnd(axis.cavity, value);
+            break;
+        case PCAV_SCAN_REG_LATCH_POINT:
+            fw_->setRegLatchPoint(axis.cavity, value);
+            break;
+    }
+}
+
+void CpcavScan::wait(const pcavScanConfig &cfg)
+{
+    if(cfg.wait) {
+        cfg.wait(cfg.usr);
+        return;
+    }
+
+    double period = 1. / cfg.pulseRate;
+    struct timespec t;
+    t.tv_sec  = (time_t) period;
+    t.tv_nsec = (long) ((period - t.tv_sec) * 1.E+9);
+    nanosleep(&t, 0);
+}
+
+void CpcavScan::evaluate(const pcavScanConfig &cfg, pcavScanResult *r)
+{
+    size_t n = history_->series(cfg.cavity, cfg.probe, PCAV_OUT_PHASE, cfg.pulses, &phase_[0]);
+    history_->series(cfg.cavity, cfg.probe, PCAV_OUT_AMPL, cfg.pulses, &ampl_[0]);
+
+    double s = 0., c = 0., a = 0.;
+    for(size_t i = 0; i < n; i++) {
+        s += sin(phase_[i] * M_PI / 180.);
+        c += cos(phase_[i] * M_PI / 180.);
+        a += ampl_[i];
+    }
+    double pm = atan2(s, c) * 180. / M_PI;
+    double am = a / n;
+
+    double pv = 0., av = 0.;
+    for(size_t i = 0; i < n; i++) {
+        double d = fmod(phase_[i] - pm + 540., 360.) - 180.;
+        pv += d * d;
+        av += (ampl_[i] - am) * (ampl_[i] - am);
+    }
+
+    r->pulses     = n;
+    r->phaseMean  = pm;
+    r->phaseNoise = sqrt(pv / n);
+    r->amplMean   = am;
+    r->amplRms    = sqrt(av / n);
+    r->snr        = (r->amplRms > 0.) ? 20. * log10(fabs(am) / r->amplRms) : HUGE_VAL;
+}
+
+int CpcavScan::run(const pcavScanConfig &cfg, std::vector<pcavScanResult> &table)
+{
+    if(cfg.nAxes < 1 || cfg.nAxes > PCAV_SCAN_MAX_AXES || cfg.pulses < 1 ||
+       (!cfg.wait && cfg.pulseRate <= 0.)) {
+        fprintf(stderr, "pcavScan: bad configuration\n");
+        return -1;
+    }
+    if((size_t) cfg.pulses > history_->capacity()) {
+        fprintf(stderr, "pcavScan: history depth %lu below %d pulses per point\n",
+                (unsigned long) history_->capacity(), cfg.pulses);
+        return -1;
+    }
+
+    int np = points(cfg);
+    int idx[PCAV_SCAN_MAX_AXES];
+    uint32_t value[PCAV_SCAN_MAX_AXES];
+
+    // everything the scan needs is allocated here, nothing inside the loop
+    table.resize(np);
+    phase_.resize(cfg.pulses);
+    ampl_.resize(cfg.pulses);
+    abort_ = false;
+
+    for(int i = 0; i < cfg.nAxes; i++) {
+        idx[i]   = 0;
+        value[i] = cfg.axis[i].start;
+        write(cfg.axis[i], value[i]);
+    }
+
+    int best = -1;
+    for(int p = 0; p < np; p++) {
+        for(int i = 0; i < cfg.settlePulses && !abort_; i++) wait(cfg);
+
+        for(int k = 0; k < cfg.pulses && !abort_; k++) {
+            wait(cfg);
+            fw_->getSnapshotCoherent(history_->next());
+            history_->push();
+        }
+        if(abort_) return -1;
+
+        pcavScanResult *r = &table[p];
+        for(int i = 0; i < cfg.nAxes; i++) r->value[i] = value[i];
+
+        // step to the next point, the evaluation below is microseconds against
+        // pulse-scale settling, so doing it serially costs nothing worth overlapping
+        if(p + 1 < np) {
+            for(int i = 0; i < cfg.nAxes; i++) {
+                if(++idx[i] < axis_points(cfg.axis[i])) {
+                    value[i] = cfg.axis[i].start + idx[i] * cfg.axis[i].step;
+                    write(cfg.axis[i], value[i]);
+                    break;
+                }
+                idx[i]   = 0;
+                value[i] = cfg.axis[i].start;
+                write(cfg.axis[i], value[i]);
+            }
+        }
+
+        evaluate(cfg, r);
+
+        if(best < 0) best = p;
+        else if(cfg.criterion == PCAV_SCAN_MIN_PHASE_NOISE && r->phaseNoise < table[best].phaseNoise) best = p;
+        else if(cfg.criterion == PCAV_SCAN_MAX_SNR && r->snr > table[best].snr) best = p;
+    }
+
+    return best;
+}
@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVSCAN_H
+#define _PCAVSCAN_H
+
+#include <vector>
+#include "pcavFw.h"
+#include "pcavHistory.h"
+
+#define PCAV_SCAN_MAX_AXES   5
+
+typedef enum {
+    PCAV_SCAN_WINDOW_START = 0,     // setWindowStart(cavity, probe)
+    PCAV_SCAN_WINDOW_END,           // setWindowEnd(cavity, probe)
+    PCAV_SCAN_FREQ_EVAL_START,      // setFreqEvalStart(cavity)
+    PCAV_SCAN_FREQ_EVAL_END,        // setFreqEvalEnd(cavity)
+    PCAV_SCAN_REG_LATCH_POINT       // setRegLatchPoint(cavity)
+} pcavScanParam;
+
+typedef enum {
+    PCAV_SCAN_MIN_PHASE_NOISE = 0,
+    PCAV_SCAN_MAX_SNR
+} pcavScanCriterion;
+
+struct pcavScanAxis {
+    pcavScanParam param;
+    int       cavity;
+    int       probe;           // window start/end only
+    uint32_t  start;           // inclusive
+    uint32_t  stop;            // inclusive
+    uint32_t  step;
+};
+
+struct pcavScanConfig {
+    int       nAxes;
+    pcavScanAxis axis[PCAV_SCAN_MAX_AXES];    // axis[0] varies fastest
+    int       cavity;          // channel evaluated at each point
+    int       probe;
+    int       pulses;          // pulses collected per point
+    int       settlePulses;    // pulses discarded after the write
+    double    pulseRate;       // Hz, paces the scan when there is no wait function
+    void    (*wait)(void *usr);    // optional, blocks until the next pulse is latched
+    void     *usr;
+    pcavScanCriterion criterion;
+};
+
+struct pcavScanResult {
+    uint32_t  value[PCAV_SCAN_MAX_AXES];
+    int       pulses;
+    double    phaseMean;       // OutPhase, degree, circular mean
+    double    phaseNoise;      // OutPhase rms around the mean, degree
+    double    amplMean;        // OutAmpl
+    double    amplRms;
+    double    snr;             // 20 log10(amplMean / amplRms), dB
+};
+
+class CpcavScan {
+private:
+    pcavFw         fw_;
+    CpcavHistory  *history_;
+    volatile bool  abort_;
+    std::vector<double> phase_;    // scratch, sized to the pulses per point before the scan
+    std::vector<double> ampl_;
+
+    void  write(const pcavScanAxis &axis, uint32_t value);
+    void  wait(const pcavScanConfig &cfg);
+    void  evaluate(const pcavScanConfig &cfg, pcavScanResult *r);
+
+public:
+    // collected pulses go to history, its depth must be at least the pulses per point
+    CpcavScan(pcavFw fw, CpcavHistory *history);
+
+    static int points(const pcavScanConfig &cfg);
+
+    // run the whole grid, table gets one row per point in scan order
+    // returns the index of the best row, or -1 on a bad configuration or abort
+    int   run(const pcavScanConfig &cfg, std::vector<pcavScanResult> &table);
+    void  abort(void);
+};
+
+#endif /* _PCAVSCAN_H */
@@ -0,0 +1,227 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavShm.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void shm_name(char *buf, size_t len, const char *name)
+{
+    snprintf(buf, len, "%s%s", (name[0] == '/') ? "" : "/", name);
+}
+
+// closes the segment of a previous run, if there is one
+static void shm_close_stale(const char *name)
+{
+    struct stat st;
+    int fd = shm_open(name, O_RDWR, 0);
+
+    if(fd < 0) return;
+    if(!fstat(fd, &st) && (size_t) st.st_size >= sizeof(pcavShmHeader)) {
+        void *m = mmap(0, sizeof(pcavShmHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(m != MAP_FAILED) {
+            pcavShmHeader *hdr = (pcavShmHeader *) m;
+            if(__atomic_load_n(&hdr->magic, __ATOMIC_RELAXED) == PCAV_SHM_MAGIC) __atomic_store_n(&hdr->magic, 0, __ATOMIC_RELEASE);
+            munmap(m, sizeof(pcavShmHeader));
+        }
+    }
+    close(fd);
+    shm_unlink(name);
+}
+
+CpcavShmWriter::CpcavShmWriter():
+    size_(0),
+    hdr_(0),
+    slot_(0)
+{
+    name_[0] = '\0';
+}
+
+pcavShmWriter CpcavShmWriter::create(const char *name, uint32_t depth)
+{
+    pcavShmWriter w(new CpcavShmWriter());
+    int fd;
+
+    if(!depth) depth = 1;
+    shm_name(w->name_, sizeof(w->name_), name);
+    w->size_ = sizeof(pcavShmHeader) + (size_t) depth * sizeof(pcavShmSlot);
+
+    shm_close_stale(w->name_);    // readers still mapping the previous segment keep their copy, marked closed
+    if((fd = shm_open(w->name_, O_CREAT | O_RDWR | O_EXCL, 0644)) < 0) {
+        fprintf(stderr, "pcavShm: shm_open %s failed (%s)\n", w->name_, strerror(errno));
+        return pcavShmWriter();
+    }
+    if(ftruncate(fd, w->size_)) {
+        fprintf(stderr, "pcavShm: ftruncate %s failed (%s)\n", w->name_, strerror(errno));
+        close(fd);
+        shm_unlink(w->name_);
+        return pcavShmWriter();
+    }
+
+    void *m = mmap(0, w->size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED) {
+        fprintf(stderr, "pcavShm: mmap %s failed (%s)\n", w->name_, strerror(errno));
+        shm_unlink(w->name_);
+        return pcavShmWriter();
+    }
+
+    w->hdr_  = (pcavShmHeader *) m;
+    w->slot_ = (pcavShmSlot *) ((char *) m + sizeof(pcavShmHeader));
+    memset(m, 0, w->size_);
+
+    w->hdr_->version  = PCAV_SHM_VERSION;
+    w->hdr_->slotSize = sizeof(pcavShmSlot);
+    w->hdr_->depth    = depth;
+    w->hdr_->published = 0;
+    __atomic_store_n(&w->hdr_->magic, PCAV_SHM_MAGIC, __ATOMIC_RELEASE);    // readers accept the segment from here on
+
+    return w;
+}
+
+CpcavShmWriter::~CpcavShmWriter()
+{
+    if(hdr_) {
+        __atomic_store_n(&hdr_->magic, 0, __ATOMIC_RELEASE);    // readers still mapping the segment see closed()
+        munmap((void *) hdr_, size_);
+        shm_unlink(name_);
+    }
+}
+
+void CpcavShmWriter::publish(const pcavSnapshot &snap)
+{
+    uint64_t     n = hdr_->published;
+    pcavShmSlot *s = &slot_[n % hdr_->depth];
+    uint64_t   seq = s->seq;
+
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    s->n    = n;
+    s->snap = snap;
+
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr_->published, n + 1, __ATOMIC_RELEASE);
+}
+
+
+CpcavShmReader::CpcavShmReader():
+    size_(0),
+    hdr_(0),
+    slot_(0)
+{
+}
+
+pcavShmReader CpcavShmReader::attach(const char *name)
+{
+    pcavShmReader r(new CpcavShmReader());
+    char   path[64];
+    struct stat st;
+    int    fd;
+
+    shm_name(path, sizeof(path), name);
+    if((fd = shm_open(path, O_RDONLY, 0)) < 0) {
+        fprintf(stderr, "pcavShm: shm_open %s failed (%s)\n", path, strerror(errno));
+        return pcavShmReader();
+    }
+    if(fstat(fd, &st) || (size_t) st.st_size < sizeof(pcavShmHeader)) {
+        fprintf(stderr, "pcavShm: %s is not a pcav segment\n", path);
+        close(fd);
+        return pcavShmReader();
+    }
+
+    void *m = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED) {
+        fprintf(stderr, "pcavShm: mmap %s failed (%s)\n", path, strerror(errno));
+        return pcavShmReader();
+    }
+
+    r->size_ = st.st_size;
+    r->hdr_  = (const pcavShmHeader *) m;
+    r->slot_ = (const pcavShmSlot *) ((const char *) m + sizeof(pcavShmHeader));
+
+    if(__atomic_load_n(&r->hdr_->magic, __ATOMIC_ACQUIRE) != PCAV_SHM_MAGIC ||
+       r->hdr_->version  != PCAV_SHM_VERSION ||
+       r->hdr_->slotSize != sizeof(pcavShmSlot) ||
+       r->hdr_->depth == 0 ||
+       sizeof(pcavShmHeader) + (size_t) r->hdr_->depth * sizeof(pcavShmSlot) > r->size_) {
+        fprintf(stderr, "pcavShm: %s layout mismatch\n", path);
+        return pcavShmReader();    // the destructor unmaps
+    }
+
+    return r;
+}
+
+CpcavShmReader::~CpcavShmReader()
+{
+    if(hdr_) munmap((void *) hdr_, size_);
+}
+
+uint64_t CpcavShmReader::published(void) const
+{
+    return __atomic_load_n(&hdr_->published, __ATOMIC_ACQUIRE);
+}
+
+bool CpcavShmReader::closed(void) const
+{
+    return __atomic_load_n(&hdr_->magic, __ATOMIC_ACQUIRE) != PCAV_SHM_MAGIC;
+}
+
+const pcavSnapshot *CpcavShmReader::peek(uint64_t n, uint64_t *token) const
+{
+    const pcavShmSlot *s = &slot_[n % hdr_->depth];
+    uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+
+    if((seq & 0x1) || s->n != n || n >= published()) return 0;
+    *token = seq;
+
+    return &s->snap;
+}
+
+bool CpcavShmReader::validate(uint64_t n, uint64_t token) const
+{
+    const pcavShmSlot *s = &slot_[n % hdr_->depth];
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&s->seq, __ATOMIC_RELAXED) == token;
+}
+
+bool CpcavShmReader::read(uint64_t n, pcavSnapshot *out) const
+{
+    uint64_t token;
+
+    for(int t = 0; t < 4; t++) {
+        const pcavSnapshot *p = peek(n, &token);
+        if(!p) return false;
+        *out = *p;
+        if(validate(n, token)) return true;
+    }
+
+    return false;
+}
+
+bool CpcavShmReader::readLatest(pcavSnapshot *out) const
+{
+    for(int t = 0; t < 4; t++) {
+        uint64_t n = published();
+        if(!n) return false;
+        if(read(n - 1, out)) return true;
+    }
+
+    return false;
+}
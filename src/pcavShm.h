@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVSHM_H
+#define _PCAVSHM_H
+
+#include "pcavFw.h"
+
+#define PCAV_SHM_MAGIC     0x70636176     // 'pcav'
+#define PCAV_SHM_VERSION   1
+
+// shared memory layout, header followed by depth slots
+// each slot has its own sequence counter (seqlock), odd while the writer is in it
+struct pcavShmHeader {
+    uint32_t  magic;           // cleared when the writer removes the segment
+    uint32_t  version;
+    uint32_t  slotSize;        // sizeof(pcavShmSlot), guards against layout mismatch
+    uint32_t  depth;
+    uint64_t  published;       // number of snapshots published, the newest is published - 1
+};
+
+struct pcavShmSlot {
+    uint64_t      seq;
+    uint64_t      n;           // snapshot number held by the slot
+    pcavSnapshot  snap;
+};
+
+
+class CpcavShmWriter;
+typedef shared_ptr<CpcavShmWriter> pcavShmWriter;
+
+// single writer, the acquiring process
+class CpcavShmWriter {
+private:
+    char          name_[64];
+    size_t        size_;
+    pcavShmHeader *hdr_;
+    pcavShmSlot   *slot_;
+
+    CpcavShmWriter();
+
+public:
+    // creates (or recreates) /dev/shm/<name>, returns an empty pointer on failure
+    static pcavShmWriter create(const char *name, uint32_t depth);
+    ~CpcavShmWriter();
+
+    void  publish(const pcavSnapshot &snap);
+};
+
+
+class CpcavShmReader;
+typedef shared_ptr<CpcavShmReader> pcavShmReader;
+
+// any number of readers, mapped read-only
+class CpcavShmReader {
+private:
+    size_t        size_;
+    const pcavShmHeader *hdr_;
+    const pcavShmSlot   *slot_;
+
+    CpcavShmReader();
+
+public:
+    static pcavShmReader attach(const char *name);
+    ~CpcavShmReader();
+
+    uint32_t  depth(void) const { return hdr_->depth; }
+    uint64_t  published(void) const;
+
+    // the writer has removed the segment, nothing more is published to this mapping,
+    // check when published() stops advancing to tell a gone writer from a stopped beam
+    bool      closed(void) const;
+
+    // zero copy access to snapshot number n, valid while validate(n, token) holds
+    // returns 0 if n has not been published yet or is already overwritten
+    const pcavSnapshot *peek(uint64_t n, uint64_t *token) const;
+    bool      validate(uint64_t n, uint64_t token) const;
+
+    // copying access, false if n is not available
+    bool      read(uint64_t n, pcavSnapshot *out) const;
+    bool      readLatest(pcavSnapshot *out) const;
+};
+
+#endif /* _PCAVSHM_H */
@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavSync.h"
+#include "pcavBus.h"
+#include "pcavUtil.h"
+
+#include <cpsw_api_builder.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+CpcavPulseSync::CpcavPulseSync():
+    mask_(0), pollUs_(0), idOffset_(-1),
+    primed_(false), last_(0), count_(0),
+    run_(false), cb_(0), arg_(0), cbTimeoutUs_(0), hasProfile_(false)
+{
+    clearStats();
+}
+
+CpcavPulseSync::~CpcavPulseSync()
+{
+    stop();
+}
+
+pcavPulseSync CpcavPulseSync::createCounter(Path counter, unsigned pollUs)
+{
+    pcavPulseSync sync(new CpcavPulseSync());
+
+    try {
+        sync->counter_ = IScalVal_RO::create(counter);
+    } catch(CPSWError &e) {
+        fprintf(stderr, "CpcavPulseSync: counter %s (%s)\n", counter->toString().c_str(), e.getInfo().c_str());
+        return pcavPulseSync();
+    }
+
+    uint64_t bits = sync->counter_->getSizeBits();
+    sync->mask_   = bits >= 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << bits) - 1);
+    sync->pollUs_ = pollUs ? pollUs : 1;
+
+    return sync;
+}
+
+pcavPulseSync CpcavPulseSync::createStream(Path stream, size_t maxFrame, int pulseIdOffset)
+{
+    pcavPulseSync sync(new CpcavPulseSync());
+
+    try {
+        sync->stream_ = IStream::create(stream);
+    } catch(CPSWError &e) {
+        fprintf(stderr, "CpcavPulseSync: stream %s (%s)\n", stream->toString().c_str(), e.getInfo().c_str());
+        return pcavPulseSync();
+    }
+
+    sync->frame_.resize(maxFrame ? maxFrame : 1);
+    sync->idOffset_ = pulseIdOffset;
+
+    return sync;
+}
+
+int CpcavPulseSync::waitCounter(unsigned timeoutUs, uint32_t *missed)
+{
+    uint64_t deadline = now_us() + timeoutUs;
+
+    for(;;) {
+        uint64_t v = 0;
+        try {
+            CPSW_TRY_CATCH(counter_, getVal(&v));
+        } catch(CPSWError &e) {
+            return -1;
+        }
+        v &= mask_;
+
+        if(!primed_) {
+            // the first read is the reference, the next change is the next latch
+            last_   = v;
+            primed_ = true;
+        }
+        else if(v != last_) {
+            uint64_t delta = (v - last_) & mask_;
+            last_   = v;
+            count_  = v;
+            *missed = (uint32_t) (delta - 1);
+            return 1;
+        }
+
+        uint64_t now = now_us();
+        if(now >= deadline) return 0;
+        sleep_us(deadline - now < pollUs_ ? deadline - now : pollUs_);
+    }
+}
+
+int CpcavPulseSync::waitStream(unsigned timeoutUs, uint32_t *missed)
+{
+    int64_t got;
+
+    try {
+        got = stream_->read(&frame_[0], frame_.size(), CTimeout(timeoutUs));
+        if(got <= 0) return 0;
+
+        // messages queued while the consumer was busy are stale, keep the newest
+        int64_t more;
+        *missed = 0;
+        while((more = stream_->read(&frame_[0], frame_.size(), CTimeout(0))) > 0) {
+            got = more;
+            (*missed)++;
+        }
+    } catch(CPSWError &e) {
+        return -1;
+    }
+
+    if(idOffset_ >= 0 && got >= idOffset_ + (int64_t) sizeof(uint64_t)) memcpy(&count_, &frame_[idOffset_], sizeof(uint64_t));
+    else                                                               count_ += 1 + *missed;
+    primed_ = true;
+
+    return 1;
+}
+
+int CpcavPulseSync::waitForPulse(unsigned timeoutUs, uint64_t *count, uint32_t *missed)
+{
+    uint32_t m = 0;
+    int r = stream_ ? waitStream(timeoutUs, &m) : waitCounter(timeoutUs, &m);
+
+    switch(r) {
+        case 1:
+            stats_.pulses++;
+            stats_.missed += m;
+            if(count)  *count  = count_;
+            if(missed) *missed = m;
+            break;
+        case 0:
+            stats_.timeouts++;
+            break;
+        default:
+            stats_.errors++;
+            break;
+    }
+
+    return r;
+}
+
+void *CpcavPulseSync::task(void *arg)
+{
+    CpcavPulseSync *p = (CpcavPulseSync *) arg;
+    uint64_t count;
+    uint32_t missed;
+
+    if(p->hasProfile_) pcavRtApply(p->profile_);
+
+    while(p->run_) {
+        switch(p->waitForPulse(p->cbTimeoutUs_, &count, &missed)) {
+            case 1:
+                p->cb_(p->arg_, count, missed);
+                break;
+            case -1:
+                sleep_us(1000);    // link down, do not spin on errors
+                break;
+        }
+    }
+
+    return 0;
+}
+
+int CpcavPulseSync::start(pcavPulseCallback cb, void *arg, unsigned timeoutUs, const pcavRtProfile *profile)
+{
+    if(run_ || !cb) return -1;
+
+    cb_          = cb;
+    arg_         = arg;
+    cbTimeoutUs_ = timeoutUs;
+    hasProfile_  = profile != 0;
+    if(profile) profile_ = *profile;
+
+    run_ = true;
+    int err = pthread_create(&thread_, 0, task, this);
+    if(err) {
+        fprintf(stderr, "CpcavPulseSync: thread create failed (%s)\n", strerror(err));
+        run_ = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+void CpcavPulseSync::stop(void)
+{
+    if(!run_) return;
+
+    run_ = false;
+    pthread_join(thread_, 0);
+}
+
+void CpcavPulseSync::getStats(pcavSyncStats *stats)
+{
+    *stats = stats_;
+}
+
+void CpcavPulseSync::clearStats(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVSYNC_H
+#define _PCAVSYNC_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+#include <cpsw_api_user.h>
+#include "pcavRt.h"
+
+// wakes acquisition once per latched pulse
+//   stream source:  a CPSW stream which carries one message per latch, the read blocks in the transport,
+//                   the primary source, no bus traffic while waiting
+//   counter source: a pulse or latch counter register, polled every pollUs, the fallback where the firmware
+//                   has no latch stream, each poll is one bus read, pick pollUs as a fraction of the beam
+//                   period, the default of 1 ms is 1/8 of 120 Hz, 1000 reads per second
+//                   the reads are counted in the bus metrics and pass the fault injection hook
+// usage: sync->waitForPulse(timeout); fw->getSnapshot(snap);
+struct pcavSyncStats {
+    uint64_t  pulses;          // wake-ups
+    uint64_t  missed;          // latches which passed without a wake-up
+    uint64_t  timeouts;
+    uint64_t  errors;
+};
+
+typedef void (*pcavPulseCallback)(void *arg, uint64_t count, uint32_t missed);
+
+class CpcavPulseSync;
+typedef shared_ptr<CpcavPulseSync> pcavPulseSync;
+
+class CpcavPulseSync {
+private:
+    ScalVal_RO counter_;
+    uint64_t  mask_;           // counter width
+    unsigned  pollUs_;
+    Stream    stream_;
+    std::vector<uint8_t> frame_;
+    int       idOffset_;       // byte offset of a 64 bit pulse ID in the stream message, -1 to count messages
+
+    bool      primed_;
+    uint64_t  last_;           // last counter value seen
+    uint64_t  count_;          // pulse count or pulse ID of the last wake-up
+    pcavSyncStats stats_;
+
+    volatile bool run_;
+    pthread_t thread_;
+    pcavPulseCallback cb_;
+    void     *arg_;
+    unsigned  cbTimeoutUs_;
+    pcavRtProfile profile_;
+    bool      hasProfile_;
+
+    CpcavPulseSync();
+    int       waitCounter(unsigned timeoutUs, uint32_t *missed);
+    int       waitStream(unsigned timeoutUs, uint32_t *missed);
+    static void *task(void *arg);
+
+public:
+    ~CpcavPulseSync();
+
+    // empty pointer if the path does not resolve
+    static pcavPulseSync createCounter(Path counter, unsigned pollUs = 1000);
+    static pcavPulseSync createStream(Path stream, size_t maxFrame = 1024, int pulseIdOffset = -1);
+
+    // block until the next latch, 1 on a pulse, 0 on timeout, -1 on a bus error
+    // count is the counter value or pulse ID of the latch, missed the latches skipped since the previous wake-up
+    int       waitForPulse(unsigned timeoutUs, uint64_t *count = 0, uint32_t *missed = 0);
+
+    // call cb once per latch from an own thread, with the profile applied to it when given
+    // do not call waitForPulse() while the thread runs
+    int       start(pcavPulseCallback cb, void *arg, unsigned timeoutUs = 100000, const pcavRtProfile *profile = 0);
+    void      stop(void);
+
+    void      getStats(pcavSyncStats *stats);
+    void      clearStats(void);
+};
+
+#endif /* _PCAVSYNC_H */
@@ -0,0 +1,260 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavSynth.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define LANES   8              // rotator lanes, one vector iteration of the kernel loops
+#define ANCHOR  256            // samples between exact re-evaluations of the rotator
+
+#define PADDED  (((MAX_SAMPLES) + LANES - 1) / LANES * LANES)
+
+
+pcavSynthParam::pcavSynthParam()
+{
+    memset(this, 0, sizeof(*this));
+    shape     = PCAV_SYNTH_CW;
+    length    = MAX_SAMPLES;
+    amplitude = 1.;
+}
+
+static uint64_t key_hash(const pcavSynthParam &p)
+{
+    const unsigned char *b = (const unsigned char *) &p;
+    uint64_t h = 0xcbf29ce484222325ULL;    // FNV-1a
+
+    for(size_t i = 0; i < sizeof(p); i++) {
+        h ^= b[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+
+CpcavSynth::CpcavSynth(size_t cacheSize):
+    cache_(cacheSize ? cacheSize : 1),
+    re_(PADDED), im_(PADDED), accRe_(PADDED), accIm_(PADDED)
+{
+    flush();
+}
+
+void CpcavSynth::flush(void)
+{
+    for(size_t k = 0; k < cache_.size(); k++) cache_[k].used = 0;
+    clock_  = 0;
+    hits_   = 0;
+    misses_ = 0;
+}
+
+int CpcavSynth::check(const pcavSynthParam &p)
+{
+    if(p.length == 0 || p.length > MAX_SAMPLES) {
+        fprintf(stderr, "CpcavSynth: length %u out of range 1..%d\n", p.length, MAX_SAMPLES);
+        return -1;
+    }
+    if(!isfinite(p.sampleRate) || p.sampleRate <= 0.) {
+        fprintf(stderr, "CpcavSynth: sample rate must be positive\n");
+        return -1;
+    }
+    if(!(p.amplitude >= 0. && p.amplitude <= 1.)) {
+        fprintf(stderr, "CpcavSynth: amplitude %g out of range 0..1\n", p.amplitude);
+        return -1;
+    }
+    if(!isfinite(p.freq) || !isfinite(p.freqEnd) || !isfinite(p.phase)) {
+        fprintf(stderr, "CpcavSynth: frequency and phase must be finite\n");
+        return -1;
+    }
+    switch(p.shape) {
+        case PCAV_SYNTH_CW:
+        case PCAV_SYNTH_CHIRP:
+            break;
+        case PCAV_SYNTH_PULSE:
+            if((uint64_t) p.delay + 2 * (uint64_t) p.edge + p.flat > p.length) {
+                fprintf(stderr, "CpcavSynth: pulse does not fit into %u samples\n", p.length);
+                return -1;
+            }
+            break;
+        case PCAV_SYNTH_MULTITONE:
+            if(p.nTones == 0 || p.nTones > PCAV_SYNTH_MAX_TONES) {
+                fprintf(stderr, "CpcavSynth: %u tones, 1..%d supported\n", p.nTones, PCAV_SYNTH_MAX_TONES);
+                return -1;
+            }
+            for(uint32_t t = 0; t < p.nTones; t++) {
+                if(!isfinite(p.toneFreq[t]) || !isfinite(p.toneAmpl[t]) || !isfinite(p.tonePhase[t])) {
+                    fprintf(stderr, "CpcavSynth: tone %u frequency, amplitude and phase must be finite\n", t);
+                    return -1;
+                }
+            }
+            break;
+        default:
+            fprintf(stderr, "CpcavSynth: unknown shape %d\n", (int) p.shape);
+            return -1;
+    }
+
+    return 0;
+}
+
+// re_/im_ = exp(j (2 pi freq k / sampleRate + phase)) for k < n rounded up to LANES
+// each lane advances by a constant rotation, the start of every ANCHOR block is evaluated exactly
+// the lanes are stored with memcpy so the rotator cannot alias the tables, GCC then vectorizes the
+// rotation loop at -O2 and the unrolled lanes at -O3
+void CpcavSynth::tone(double freq, double sampleRate, double phase, uint32_t n)
+{
+    double w  = 2. * M_PI * freq / sampleRate;
+    double sr = cos(LANES * w);
+    double si = sin(LANES * w);
+    double *re = &re_[0];
+    double *im = &im_[0];
+
+    for(uint32_t base = 0; base < n; base += ANCHOR) {
+        double cr[LANES], ci[LANES];
+        uint32_t end = base + ANCHOR < n ? base + ANCHOR : n;
+
+        for(int l = 0; l < LANES; l++) {
+            double ph = fmod(w * (double) (base + l), 2. * M_PI) + phase;
+            cr[l] = cos(ph);
+            ci[l] = sin(ph);
+        }
+        for(uint32_t k = base; k < end; k += LANES) {
+            memcpy(re + k, cr, sizeof(cr));
+            memcpy(im + k, ci, sizeof(ci));
+            for(int l = 0; l < LANES; l++) {
+                double r = cr[l], i = ci[l];
+                cr[l] = r * sr - i * si;
+                ci[l] = r * si + i * sr;
+            }
+        }
+    }
+}
+
+// phase(k) = phase + 2 pi (f0 k + (f1 - f0) k^2 / (2 length)) / sampleRate, evaluated per sample
+void CpcavSynth::chirp(const pcavSynthParam &p, uint32_t n)
+{
+    double a  = 2. * M_PI * p.freq / p.sampleRate;
+    double b  = M_PI * (p.freqEnd - p.freq) / (p.sampleRate * p.length);
+    double ph = p.phase * M_PI / 180.;
+
+    for(uint32_t k = 0; k < n; k++) {
+        double x = fmod((a + b * k) * k, 2. * M_PI) + ph;
+        re_[k] = cos(x);
+        im_[k] = sin(x);
+    }
+}
+
+// multiplies re_/im_ with the flat-top envelope, zero outside the pulse
+void CpcavSynth::envelope(const pcavSynthParam &p, uint32_t n)
+{
+    uint32_t rise = p.delay + p.edge;
+    uint32_t fall = rise + p.flat;
+    uint32_t stop = fall + p.edge;
+    double   step = p.edge ? M_PI / p.edge : 0.;
+
+    for(uint32_t k = 0; k < n; k++) {
+        double e;
+        if(k < p.delay || k >= stop) e = 0.;
+        else if(k < rise)            e = .5 * (1. - cos(step * (k - p.delay + .5)));
+        else if(k < fall)            e = 1.;
+        else                         e = .5 * (1. + cos(step * (k - fall + .5)));
+        re_[k] *= e;
+        im_[k] *= e;
+    }
+}
+
+// scale and convert with dacSample(), samples after length are zero
+void CpcavSynth::quantize(const double *re, const double *im, double scale, pcavSynthTable *table)
+{
+    uint32_t n = table->length;
+
+    for(uint32_t k = 0; k < n; k++) {
+        table->i[k] = dacSample(re[k] * scale);
+        table->q[k] = dacSample(im[k] * scale);
+    }
+    memset(table->i + n, 0, (MAX_SAMPLES - n) * sizeof(int16_t));
+    memset(table->q + n, 0, (MAX_SAMPLES - n) * sizeof(int16_t));
+}
+
+int CpcavSynth::synthesize(const pcavSynthParam &p, pcavSynthTable *table)
+{
+    if(check(p)) return -1;
+
+    uint32_t n = p.length;
+    table->length = n;
+
+    switch(p.shape) {
+        case PCAV_SYNTH_CW:
+            tone(p.freq, p.sampleRate, p.phase * M_PI / 180., n);
+            break;
+        case PCAV_SYNTH_CHIRP:
+            chirp(p, n);
+            break;
+        case PCAV_SYNTH_PULSE:
+            tone(p.freq, p.sampleRate, p.phase * M_PI / 180., n);
+            envelope(p, n);
+            break;
+        case PCAV_SYNTH_MULTITONE:
+            memset(&accRe_[0], 0, n * sizeof(double));
+            memset(&accIm_[0], 0, n * sizeof(double));
+            for(uint32_t t = 0; t < p.nTones; t++) {
+                double a = p.toneAmpl[t];
+                tone(p.toneFreq[t], p.sampleRate, p.tonePhase[t] * M_PI / 180., n);
+                for(uint32_t k = 0; k < n; k++) {
+                    accRe_[k] += a * re_[k];
+                    accIm_[k] += a * im_[k];
+                }
+            }
+            quantize(&accRe_[0], &accIm_[0], p.amplitude, table);
+            return 0;
+    }
+    quantize(&re_[0], &im_[0], p.amplitude, table);
+
+    return 0;
+}
+
+const pcavSynthTable *CpcavSynth::get(const pcavSynthParam &param)
+{
+    uint64_t h = key_hash(param);
+    entry   *victim = &cache_[0];
+
+    for(size_t k = 0; k < cache_.size(); k++) {
+        entry *e = &cache_[k];
+        if(e->used && e->hash == h && !memcmp(&e->param, &param, sizeof(param))) {
+            e->used = ++clock_;
+            hits_++;
+            return &e->table;
+        }
+        if(e->used < victim->used) victim = e;
+    }
+
+    // invalid parameters must not cost a cached table
+    if(check(param)) return 0;
+
+    misses_++;
+    victim->used = 0;
+    if(synthesize(param, &victim->table)) return 0;
+    memcpy(&victim->param, &param, sizeof(param));
+    victim->hash = h;
+    victim->used = ++clock_;
+
+    return &victim->table;
+}
+
+int CpcavSynth::upload(dacSigGenFw dac, const pcavSynthParam &param)
+{
+    const pcavSynthTable *t = get(param);
+
+    if(!t) return -1;
+    if(dac->setWaveform(DAC_CHANNEL_I, t->i, t->length)) return -1;
+
+    return dac->setWaveform(DAC_CHANNEL_Q, t->q, t->length);
+}
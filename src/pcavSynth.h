@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVSYNTH_H
+#define _PCAVSYNTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "dacSigGenFw.h"
+
+#define PCAV_SYNTH_MAX_TONES  8
+
+typedef enum {
+    PCAV_SYNTH_CW,             // I + jQ = A exp(j (2 pi f t + phase))
+    PCAV_SYNTH_CHIRP,          // linear sweep from freq to freqEnd over length
+    PCAV_SYNTH_PULSE,          // CW carrier in a flat-top envelope with raised cosine edges, freq 0 for baseband
+    PCAV_SYNTH_MULTITONE       // sum of tones, the sum must stay within full scale
+} pcavSynthShape;
+
+// waveform parameters, also the cache key: set fields on a default constructed instance
+struct pcavSynthParam {
+    pcavSynthShape shape;
+    uint32_t  length;          // samples, up to MAX_SAMPLES, the rest of the table is zero
+    double    sampleRate;      // DAC sample rate, Hz
+    double    amplitude;       // full scale 1.0
+    double    freq;            // Hz, chirp start
+    double    freqEnd;         // Hz, chirp end
+    double    phase;           // degree
+    uint32_t  delay;           // pulse: samples before the rising edge
+    uint32_t  edge;            // pulse: samples of each raised cosine edge
+    uint32_t  flat;            // pulse: samples of the flat top
+    uint32_t  nTones;          // multitone
+    double    toneFreq[PCAV_SYNTH_MAX_TONES];
+    double    toneAmpl[PCAV_SYNTH_MAX_TONES];
+    double    tonePhase[PCAV_SYNTH_MAX_TONES];    // degree
+
+    pcavSynthParam();          // zeroes padding as well, the key is compared bytewise
+};
+
+struct pcavSynthTable {
+    uint32_t  length;
+    int16_t   i[MAX_SAMPLES];
+    int16_t   q[MAX_SAMPLES];
+};
+
+// generates DAC tables from parameters and keeps the recently used ones, all tables are allocated at construction
+class CpcavSynth {
+private:
+    struct entry {
+        pcavSynthParam param;
+        uint64_t  hash;
+        uint64_t  used;        // LRU stamp, 0 for a free slot
+        pcavSynthTable table;
+    };
+    std::vector<entry>  cache_;
+    uint64_t  clock_;
+    uint64_t  hits_;
+    uint64_t  misses_;
+
+    // scratch, padded to the kernel block
+    std::vector<double> re_;
+    std::vector<double> im_;
+    std::vector<double> accRe_;
+    std::vector<double> accIm_;
+
+    void      tone(double freq, double sampleRate, double phase, uint32_t n);
+    void      chirp(const pcavSynthParam &p, uint32_t n);
+    void      envelope(const pcavSynthParam &p, uint32_t n);
+    void      quantize(const double *re, const double *im, double scale, pcavSynthTable *table);
+
+public:
+    CpcavSynth(size_t cacheSize);
+
+    static int check(const pcavSynthParam &param);     // 0 if the parameters are valid
+
+    // table for the parameters, from the cache or synthesized into the least recently used slot
+    // valid until cacheSize other parameter sets have been requested, 0 for invalid parameters
+    const pcavSynthTable *get(const pcavSynthParam &param);
+
+    // synthesize without the cache
+    int       synthesize(const pcavSynthParam &param, pcavSynthTable *table);
+
+    // get() and write both tables to the DAC, PeriodSize follows the length
+    int       upload(dacSigGenFw dac, const pcavSynthParam &param);
+
+    uint64_t  hits(void) const   { return hits_; }
+    uint64_t  misses(void) const { return misses_; }
+    void      flush(void);
+};
+
+#endif /* _PCAVSYNTH_H */
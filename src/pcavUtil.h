@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVUTIL_H
+#define _PCAVUTIL_H
+
+// small helpers shared by the pcavLib sources, internal, not installed
+
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include "pcavFw.h"
+
+// monotonic clock
+static inline uint64_t now_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static inline uint64_t now_us(void)
+{
+    return now_ns() / 1000;
+}
+
+static inline void sleep_ns(uint64_t ns)
+{
+    struct timespec t;
+
+    t.tv_sec  = ns / 1000000000;
+    t.tv_nsec = ns % 1000000000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, 0, &t, &t) == EINTR) ;
+}
+
+static inline void sleep_us(uint64_t us)
+{
+    sleep_ns(us * 1000);
+}
+
+// degree to [-180, 180)
+static inline double wrap_phase(double p)
+{
+    return p - 360. * floor((p + 180.) / 360.);
+}
+
+// value of pcavRecField() k, reference fields first, then val[cavity][probe][field]
+static inline double field_value(const pcavSnapshot &s, int k)
+{
+    return k < PCAV_NUM_REF_FIELDS ? s.ref[k] : (&s.val[0][0][0])[k - PCAV_NUM_REF_FIELDS];
+}
+
+#endif /* _PCAVUTIL_H */
@@ -0,0 +1,175 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavXcheck.h"
+#include "pcavUtil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define LSB_INTEG   (1. / (double) (1<<16))             // IntegI/Q, OutAmpl, fixed 18.16
+#define LSB_PHASE   (180. / (double) (1<<15))           // OutPhase, CompPhase, fixed 18.15 in half turns
+#define LSB_IF      (1. / (double) (1<<17))             // IfAmpl, fixed 18.17
+#define RAD2DEG     (180. / M_PI)
+
+
+CpcavXcheck::CpcavXcheck(size_t window):
+    window_(window)
+{
+    if(!window_) {
+        fprintf(stderr, "pcavXcheck: window 0, using 1\n");
+        window_ = 1;
+    }
+
+    for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+        i_[p].resize(window_);        q_[p].resize(window_);       ifAmpl_[p].resize(window_);
+        outPhase_[p].resize(window_); outAmpl_[p].resize(window_); compPhase_[p].resize(window_);
+        phase_[p].resize(window_);    ampl_[p].resize(window_);    phaseTol_[p].resize(window_);
+    }
+
+    checkedAny_  = false;
+    lastChecked_ = 0;
+
+    config_.tolScale    = 4.;
+    config_.phaseTolAbs = 0.;
+    config_.amplTolAbs  = 0.;
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++)
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            setSettings(c, p, 0., 1.);
+            setCalibCoeff(c, p, 0.);
+        }
+
+    clearStats();
+}
+
+void CpcavXcheck::setConfig(const pcavXcheckConfig &config)
+{
+    config_ = config;
+}
+
+void CpcavXcheck::setSettings(int cavity, int probe, double offset, double weight)
+{
+    offset_[cavity][probe] = offset;
+    weight_[cavity][probe] = weight;
+}
+
+void CpcavXcheck::setCalibCoeff(int cavity, int probe, double coeff)
+{
+    coeff_[cavity][probe] = coeff;
+}
+
+void CpcavXcheck::loadSettings(pcavFw fw)
+{
+    int32_t raw;
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            offset_[c][p] = fw->getPhaseOffset(c, p, &raw);
+            weight_[c][p] = fw->getWeight(c, p, &raw);
+        }
+    }
+}
+
+size_t CpcavXcheck::check(const CpcavHistory &history, size_t n, pcavXcheckPulse *out)
+{
+    size_t flagged = 0;
+
+    if(n > window_) n = window_;
+    if(n > history.size()) n = history.size();
+    if(!n) return 0;
+
+    for(size_t k = 0; k < n; k++) {
+        memset(&out[k], 0, sizeof(pcavXcheckPulse));
+        out[k].pulseId = history.get(n - 1 - k)->pulseId;
+    }
+
+    for(int c = 0; c < PCAV_NUM_CAVITY; c++) {
+        for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+            history.series(c, p, PCAV_INTEG_I,     n, &i_[p][0]);
+            history.series(c, p, PCAV_INTEG_Q,     n, &q_[p][0]);
+            history.series(c, p, PCAV_IF_AMPL,     n, &ifAmpl_[p][0]);
+            history.series(c, p, PCAV_OUT_PHASE,   n, &outPhase_[p][0]);
+            history.series(c, p, PCAV_OUT_AMPL,    n, &outAmpl_[p][0]);
+            history.series(c, p, PCAV_COMP_PHASE,  n, &compPhase_[p][0]);
+
+            // straight loops over contiguous arrays
+            double *I = &i_[p][0], *Q = &q_[p][0];
+            double *ph = &phase_[p][0], *am = &ampl_[p][0], *tol = &phaseTol_[p][0];
+            double off = offset_[c][p];
+            for(size_t k = 0; k < n; k++) {
+                am[k]  = sqrt(I[k] * I[k] + Q[k] * Q[k]);
+                ph[k]  = atan2(Q[k], I[k]) * RAD2DEG + off;
+                // one integrator LSB moves the angle by LSB/|IQ| radian
+                tol[k] = config_.tolScale * (LSB_PHASE + RAD2DEG * LSB_INTEG / (am[k] > LSB_INTEG ? am[k] : LSB_INTEG))
+                         + config_.phaseTolAbs;
+            }
+        }
+
+        double w0 = weight_[c][0], w1 = weight_[c][1];
+        double k0 = 180. * coeff_[c][0], k1 = 180. * coeff_[c][1];
+        double amplTol = config_.tolScale * 2. * LSB_INTEG + config_.amplTolAbs;
+        double coeffTol = config_.tolScale * LSB_IF * (fabs(k0) > fabs(k1) ? fabs(k0) : fabs(k1));
+
+        for(size_t k = 0; k < n; k++) {
+            pcavXcheckPulse *o = &out[k];
+
+            // weighted circular mean of the amplitude compensated probe phases
+            double c0 = (phase_[0][k] + k0 * ifAmpl_[0][k]) / RAD2DEG;
+            double c1 = (phase_[1][k] + k1 * ifAmpl_[1][k]) / RAD2DEG;
+            double comp = atan2(w0 * sin(c0) + w1 * sin(c1), w0 * cos(c0) + w1 * cos(c1)) * RAD2DEG;
+            double compTol = ((phaseTol_[0][k] > phaseTol_[1][k]) ? phaseTol_[0][k] : phaseTol_[1][k]) + coeffTol;
+            bool   fresh = !checkedAny_ || o->pulseId > lastChecked_;
+
+            for(int p = 0; p < PCAV_NUM_PROBE; p++) {
+                o->dPhase[c][p] = wrap_phase(outPhase_[p][k] - phase_[p][k]);
+                o->dAmpl[c][p]  = outAmpl_[p][k] - ampl_[p][k];
+                o->dComp[c][p]  = wrap_phase(compPhase_[p][k] - comp);
+
+                if(fabs(o->dPhase[c][p]) > phaseTol_[p][k]) o->flags[c][p] |= PCAV_XCHECK_PHASE;
+                if(fabs(o->dAmpl[c][p])  > amplTol)         o->flags[c][p] |= PCAV_XCHECK_AMPL;
+                if(fabs(o->dComp[c][p])  > compTol)         o->flags[c][p] |= PCAV_XCHECK_COMP;
+
+                if(!fresh) continue;
+                if(o->flags[c][p] & PCAV_XCHECK_PHASE) stats_.phase[c][p]++;
+                if(o->flags[c][p] & PCAV_XCHECK_AMPL)  stats_.ampl[c][p]++;
+                if(o->flags[c][p] & PCAV_XCHECK_COMP)  stats_.comp[c][p]++;
+                if(fabs(o->dPhase[c][p]) > stats_.maxPhase) stats_.maxPhase = fabs(o->dPhase[c][p]);
+                if(fabs(o->dAmpl[c][p])  > stats_.maxAmpl)  stats_.maxAmpl  = fabs(o->dAmpl[c][p]);
+                if(fabs(o->dComp[c][p])  > stats_.maxComp)  stats_.maxComp  = fabs(o->dComp[c][p]);
+            }
+        }
+    }
+
+    for(size_t k = 0; k < n; k++) {
+        uint32_t any = 0;
+        for(int c = 0; c < PCAV_NUM_CAVITY; c++)
+            for(int p = 0; p < PCAV_NUM_PROBE; p++) any |= out[k].flags[c][p];
+        if(any) flagged++;
+
+        if(checkedAny_ && out[k].pulseId <= lastChecked_) continue;
+        stats_.pulses++;
+        if(any) stats_.flagged++;
+    }
+    checkedAny_  = true;
+    lastChecked_ = out[n - 1].pulseId;
+
+    return flagged;
+}
+
+void CpcavXcheck::getStats(pcavXcheckStats *stats)
+{
+    *stats = stats_;
+}
+
+void CpcavXcheck::clearStats(void)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
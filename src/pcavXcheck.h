@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVXCHECK_H
+#define _PCAVXCHECK_H
+
+#include <vector>
+#include "pcavFw.h"
+#include "pcavHistory.h"
+
+// discrepancy flags per cavity and probe
+#define PCAV_XCHECK_PHASE   0x1     // OutPhase    != atan2(IntegQ, IntegI) + PhaseOffset
+#define PCAV_XCHECK_AMPL    0x2     // OutAmpl     != |IntegI + j IntegQ|
+#define PCAV_XCHECK_COMP    0x4     // CompPhase   != weighted mean of the compensated probe phases, model in pcavCalib.h
+
+struct pcavXcheckConfig {
+    double    tolScale;        // tolerance in units of the propagated quantization error, e.g. 4
+    double    phaseTolAbs;     // additional absolute tolerances, degree and amplitude units
+    double    amplTolAbs;
+};
+
+struct pcavXcheckPulse {
+    uint64_t  pulseId;
+    uint32_t  flags[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    dPhase[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];   // firmware - recomputed
+    double    dAmpl[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    dComp[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+};
+
+// every pulse counts once, overlapping windows do not count a pulse again
+struct pcavXcheckStats {
+    uint64_t  pulses;
+    uint64_t  flagged;         // pulses with at least one discrepancy
+    uint64_t  phase[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    uint64_t  ampl[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    uint64_t  comp[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    maxPhase;        // worst |deviation| seen
+    double    maxAmpl;
+    double    maxComp;
+};
+
+// recomputes the firmware outputs from the integrated I/Q of recorded snapshots,
+// works on the history only, PhaseOffset and Weight are read once by loadSettings(),
+// CalibCoeff has no readback and is set by setCalibCoeff()
+class CpcavXcheck {
+private:
+    size_t    window_;
+    pcavXcheckConfig config_;
+    double    offset_[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];    // degree
+    double    weight_[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];
+    double    coeff_[PCAV_NUM_CAVITY][PCAV_NUM_PROBE];     // half turns per IfAmpl
+    bool      checkedAny_;
+    uint64_t  lastChecked_;    // newest pulse ID in the stats
+    pcavXcheckStats stats_;
+
+    // per window scratch, structure of arrays
+    std::vector<double> i_[PCAV_NUM_PROBE], q_[PCAV_NUM_PROBE], ifAmpl_[PCAV_NUM_PROBE];
+    std::vector<double> outPhase_[PCAV_NUM_PROBE], outAmpl_[PCAV_NUM_PROBE], compPhase_[PCAV_NUM_PROBE];
+    std::vector<double> phase_[PCAV_NUM_PROBE], ampl_[PCAV_NUM_PROBE], phaseTol_[PCAV_NUM_PROBE];
+
+public:
+    CpcavXcheck(size_t window);     // window 0 is taken as 1
+
+    void  setConfig(const pcavXcheckConfig &config);
+    void  setSettings(int cavity, int probe, double offset, double weight);
+    void  setCalibCoeff(int cavity, int probe, double coeff);
+    void  loadSettings(pcavFw fw);
+
+    // check the last n snapshots (n <= window), out[] gets one entry per pulse, oldest first
+    // returns the number of pulses with a discrepancy
+    size_t check(const CpcavHistory &history, size_t n, pcavXcheckPulse *out);
+
+    void  getStats(pcavXcheckStats *stats);
+    void  clearStats(void);
+};
+
+#endif /* _PCAVXCHECK_H */
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "pcavXcorr.h"
+
+#include <string.h>
+#include <math.h>
+
+
+CpcavXcorr::CpcavXcorr(const pcavXcorrConfig &config):
+    config_(config),
+    fft_(2 * (config.frameLen ? config.frameLen : 1))    // zero padded, linear not circular correlation
+{
+    size_t n = fft_.size();
+
+    if(config_.alpha <= 0. || config_.alpha > 1.) config_.alpha = 1.;
+    if(config_.updateEvery < 1) config_.updateEvery = 1;
+    if(config_.maxLag <= 0 || (size_t) config_.maxLag >= config_.frameLen)
+        config_.maxLag = config_.frameLen ? config_.frameLen - 1 : 0;
+
+    a_.resize(2 * n);
+    b_.resize(2 * n);
+    cross_.resize(2 * n);
+    corr_.resize(2 * n);
+
+    reset();
+}
+
+void CpcavXcorr::reset(void)
+{
+    for(size_t i = 0; i < cross_.size(); i++) cross_[i] = 0.;
+    energyA_ = energyB_ = 0.;
+    frames_  = 0;
+    memset(&result_, 0, sizeof(result_));
+}
+
+void CpcavXcorr::accumulate(void)
+{
+    size_t n = fft_.size();
+    double al = (frames_ == 0) ? 1. : config_.alpha;
+    double ea = 0., eb = 0.;
+
+    fft_.forward(&a_[0]);
+    fft_.forward(&b_[0]);
+
+    // conj(A) * B, and the channel energies by Parseval
+    for(size_t k = 0; k < n; k++) {
+        double ar = a_[2*k], ai = a_[2*k + 1];
+        double br = b_[2*k], bi = b_[2*k + 1];
+        cross_[2*k]     += al * ((ar * br + ai * bi) - cross_[2*k]);
+        cross_[2*k + 1] += al * ((ar * bi - ai * br) - cross_[2*k + 1]);
+        ea += ar * ar + ai * ai;
+        eb += br * br + bi * bi;
+    }
+    energyA_ += al * (ea / n - energyA_);
+    energyB_ += al * (eb / n - energyB_);
+
+    frames_++;
+}
+
+void CpcavXcorr::search(void)
+{
+    size_t n = fft_.size();
+
+    memcpy(&corr_[0], &cross_[0], 2 * n * sizeof(double));
+    fft_.inverse(&corr_[0]);
+
+    // lag k sits at index k, negative lags wrap to the end
+    int    best = 0;
+    double peak = -HUGE_VAL;
+    for(int k = -config_.maxLag; k <= config_.maxLag; k++) {
+        double v = corr_[2 * ((k + n) % n)];
+        if(v > peak) { peak = v; best = k; }
+    }
+
+    double d = best;
+    if(best > -config_.maxLag && best < config_.maxLag) {
+        double ym = corr_[2 * ((best - 1 + n) % n)];
+        double yp = corr_[2 * ((best + 1 + n) % n)];
+        double den = ym - 2. * peak + yp;
+        if(den < 0.) d += 0.5 * (ym - yp) / den;
+    }
+
+    double norm = sqrt(energyA_ * energyB_);
+
+    result_.valid      = true;
+    result_.frames     = frames_;
+    result_.delay      = d;
+    result_.delaySec   = (config_.sampleRate > 0.) ? d / config_.sampleRate : 0.;
+    result_.confidence = (norm > 0.) ? peak / norm : 0.;
+}
+
+bool CpcavXcorr::process(const float *a, const float *b)
+{
+    size_t n = fft_.size();
+
+    for(size_t i = 0; i < n; i++) {
+        bool in = i < config_.frameLen;
+        a_[2*i] = in ? a[i] : 0.;  a_[2*i + 1] = 0.;
+        b_[2*i] = in ? b[i] : 0.;  b_[2*i + 1] = 0.;
+    }
+    accumulate();
+
+    if(frames_ % config_.updateEvery) return false;
+    search();
+
+    return true;
+}
+
+bool CpcavXcorr::process(const int16_t *a, const int16_t *b)
+{
+    size_t n = fft_.size();
+
+    for(size_t i = 0; i < n; i++) {
+        bool in = i < config_.frameLen;
+        a_[2*i] = in ? a[i] / 32768. : 0.;  a_[2*i + 1] = 0.;
+        b_[2*i] = in ? b[i] / 32768. : 0.;  b_[2*i + 1] = 0.;
+    }
+    accumulate();
+
+    if(frames_ % config_.updateEvery) return false;
+    search();
+
+    return true;
+}
+
+void CpcavXcorr::getResult(pcavXcorrResult *result)
+{
+    *result = result_;
+}
@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'pcavLib'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'pcavLib', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _PCAVXCORR_H
+#define _PCAVXCORR_H
+
+#include <stdint.h>
+#include <vector>
+#include "pcavFft.h"
+
+// delay between two wfData channels (probe 0 vs probe 1, or cavity 0 vs cavity 1)
+// from the peak of their FFT cross-correlation, positive when b lags a
+struct pcavXcorrConfig {
+    size_t    frameLen;        // samples per channel and pulse
+    double    sampleRate;      // Hz, for the delay in seconds
+    double    alpha;           // exponential averaging of the cross spectrum, 1 for no averaging
+    int       maxLag;          // search window in samples, 0 for the whole frame
+    int       updateEvery;     // peak search every n pulses, the spectrum is accumulated every pulse
+};
+
+struct pcavXcorrResult {
+    bool      valid;
+    uint64_t  frames;
+    double    delay;           // samples, parabolic sub-sample interpolation
+    double    delaySec;
+    double    confidence;      // normalized correlation at the peak, 0..1
+};
+
+class CpcavXcorr {
+private:
+    pcavXcorrConfig config_;
+    CpcavFft  fft_;
+    std::vector<double> a_, b_;      // spectra, interleaved complex
+    std::vector<double> cross_;      // averaged cross spectrum
+    std::vector<double> corr_;
+    double    energyA_, energyB_;    // averaged like the cross spectrum
+    uint64_t  frames_;
+    pcavXcorrResult result_;
+
+    void      accumulate(void);
+    void      search(void);
+
+public:
+    CpcavXcorr(const pcavXcorrConfig &config);
+
+    void      reset(void);
+
+    // one pulse of both channels, frameLen samples each, returns true when result was updated
+    bool      process(const float *a, const float *b);
+    bool      process(const int16_t *a, const int16_t *b);
+
+    void      getResult(pcavXcorrResult *result);
+};
+
+#endif /* _PCAVXCORR_H */